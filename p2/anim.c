@@ -0,0 +1,320 @@
+/**
+    @file anim.c
+    @author Nicholas Board (ndboard)
+
+    Relabels an animated diagram when one seed moves.  Every pixel
+    that changes owner is inside the seed's old region or its new
+    one.  Each region is convex, so the tiles it overlaps are
+    connected, and they're found by flooding outward over tiles from
+    the seed, using each tile's reach to rule out the tiles the
+    region can't get to.
+*/
+
+#include<stdlib.h>
+#include<string.h>
+#include"anim.h"
+
+/** Moved seeds allowed before the tree is rebuilt. */
+#define MOVED_LIMIT 16
+
+/** Added to every reach.  A point inside a pixel is at most half a
+    diagonal, about 0.71, farther from its owner than the pixel's
+    center, and the rest is room for rounding. */
+#define REACH_SLACK 1.0
+
+/** Upper bound on the distance from a white pixel to its nearest seed. */
+#define WHITE_REACH 0.7072
+
+/**
+    Finds the owner of a pixel, checking the tree for seeds that
+    haven't moved and the moved seeds one by one.
+
+    @param a The animation.
+    @param col The column of the pixel.
+    @param row The row of the pixel.
+    @param hint A seed likely to be close, or NO_OWNER.
+    @return The owner of the pixel.
+*/
+static int ownerOf( Animation const *a, int col, int row, int hint )
+{
+  Nearest best;
+  initNearest( &best );
+
+  if ( hint != NO_OWNER )
+    considerSeed( &best, a->list, hint, col, row );
+
+  searchTree( a->tree, col, row, a->movedCount ? a->moved : NULL, &best );
+  for ( int i = 0; i < a->movedCount; i++ )
+    considerSeed( &best, a->list, a->movedList[ i ], col, row );
+
+  return best.owner;
+}
+
+/**
+    Recomputes how far a tile's pixels are from their owners.
+
+    @param a The animation.
+    @param t The tile.
+*/
+static void updateReach( Animation *a, int t )
+{
+  int c0 = t % a->tilesWide * TILE;
+  int r0 = t / a->tilesWide * TILE;
+  int c1 = c0 + TILE < a->width ? c0 + TILE : a->width;
+  int r1 = r0 + TILE < a->height ? r0 + TILE : a->height;
+  double reach = 0;
+
+  for ( int row = r0; row < r1; row++ ) {
+    for ( int col = c0; col < c1; col++ ) {
+      int o = a->labels[ ( long ) row * a->width + col ];
+      double d = WHITE_REACH;
+      if ( o != NO_OWNER ) {
+        double dx = col - a->list[ o ].x;
+        double dy = row - a->list[ o ].y;
+        d = sqrt( dx * dx + dy * dy );
+      }
+
+      if ( d > reach )
+        reach = d;
+    }
+  }
+
+  a->reach[ t ] = reach;
+}
+
+/**
+    Checks whether a seed's region could include any point of a tile.
+
+    @param a The animation.
+    @param s The seed.
+    @param t The tile.
+    @return False only if no point of the tile can be owned by the seed.
+*/
+static bool reachable( Animation const *a, Seed const *s, int t )
+{
+  // The tile covers its pixels out to half a pixel past their centers.
+  double x0 = t % a->tilesWide * TILE - 0.5;
+  double y0 = t / a->tilesWide * TILE - 0.5;
+  double x1 = ( x0 + TILE < a->width - 0.5 ? x0 + TILE : a->width - 0.5 );
+  double y1 = ( y0 + TILE < a->height - 0.5 ? y0 + TILE : a->height - 0.5 );
+
+  double dx = s->x < x0 ? x0 - s->x : ( s->x > x1 ? s->x - x1 : 0 );
+  double dy = s->y < y0 ? y0 - s->y : ( s->y > y1 ? s->y - y1 : 0 );
+
+  return sqrt( dx * dx + dy * dy ) <= a->reach[ t ] + REACH_SLACK;
+}
+
+/**
+    Checks whether a tile passes for the flood from a seed.  Tiles
+    reached from the old position always pass for the new one, since
+    their reach still counts the seed as it was.
+
+    @param a The animation.
+    @param s The seed.
+    @param t The tile.
+    @param seen The marks for this flood.
+    @param fromNew True for the flood from the seed's new position.
+    @return True if the flood should include the tile.
+*/
+static bool admits( Animation const *a, Seed const *s, int t, int const *seen,
+                    bool fromNew )
+{
+  if ( seen[ t ] == a->frame )
+    return false;
+  return ( fromNew && a->seenOld[ t ] == a->frame ) || reachable( a, s, t );
+}
+
+/**
+    Floods over the tiles a seed's region could overlap, adding the
+    ones no flood has reached yet to the touched list.
+
+    @param a The animation.
+    @param s The seed, at its old or new position.
+    @param fromNew True for the flood from the seed's new position.
+*/
+static void flood( Animation *a, Seed const *s, bool fromNew )
+{
+  int *seen = fromNew ? a->seenNew : a->seenOld;
+  int tiles = a->tilesWide * a->tilesHigh;
+  int head = 0;
+  int tail = 0;
+
+  // Start at the seed's tile, or if it's off the canvas, at every edge
+  // tile it can reach, since its region has to come in across the edge.
+  if ( s->col >= 0 && s->col < a->width && s->row >= 0 && s->row < a->height ) {
+    int t = ( int ) s->row / TILE * a->tilesWide + ( int ) s->col / TILE;
+    seen[ t ] = a->frame;
+    a->queue[ tail++ ] = t;
+  } else {
+    for ( int t = 0; t < tiles; t++ ) {
+      int x = t % a->tilesWide;
+      int y = t / a->tilesWide;
+      bool edge = x == 0 || y == 0 || x == a->tilesWide - 1 || y == a->tilesHigh - 1;
+      if ( edge && admits( a, s, t, seen, fromNew ) ) {
+        seen[ t ] = a->frame;
+        a->queue[ tail++ ] = t;
+      }
+    }
+  }
+
+  while ( head < tail ) {
+    int t = a->queue[ head++ ];
+
+    // Tiles from both floods are only relabeled once.
+    if ( !fromNew || a->seenOld[ t ] != a->frame )
+      a->touched[ a->touchedCount++ ] = t;
+
+    // Regions can meet a tile at just a corner, so look at all eight.
+    int x = t % a->tilesWide;
+    int y = t / a->tilesWide;
+    for ( int ny = y - 1; ny <= y + 1; ny++ ) {
+      for ( int nx = x - 1; nx <= x + 1; nx++ ) {
+        if ( nx < 0 || ny < 0 || nx >= a->tilesWide || ny >= a->tilesHigh )
+          continue;
+
+        int n = ny * a->tilesWide + nx;
+        if ( admits( a, s, n, seen, fromNew ) ) {
+          seen[ n ] = a->frame;
+          a->queue[ tail++ ] = n;
+        }
+      }
+    }
+  }
+}
+
+/**
+    Relabels the pixels of a tile after seed k has moved.  Pixels that
+    k owned, and white ones, are looked up again.  Other pixels keep
+    their owner unless k is now at least as close.
+
+    @param a The animation.
+    @param t The tile.
+    @param k The seed that moved.
+*/
+static void relabelTile( Animation *a, int t, int k )
+{
+  int c0 = t % a->tilesWide * TILE;
+  int r0 = t / a->tilesWide * TILE;
+  int c1 = c0 + TILE < a->width ? c0 + TILE : a->width;
+  int r1 = r0 + TILE < a->height ? r0 + TILE : a->height;
+  Seed const *s = &a->list[ k ];
+
+  for ( int row = r0; row < r1; row++ ) {
+    for ( int col = c0; col < c1; col++ ) {
+      int *o = &a->labels[ ( long ) row * a->width + col ];
+
+      if ( *o != k && *o != NO_OWNER ) {
+        double dx = col - s->x;
+        double dy = row - s->y;
+        double ox = col - a->list[ *o ].x;
+        double oy = row - a->list[ *o ].y;
+        if ( dx * dx + dy * dy > ox * ox + oy * oy )
+          continue;
+      }
+
+      *o = ownerOf( a, col, row, *o == k ? NO_OWNER : *o );
+    }
+  }
+}
+
+Animation *startAnimation( Seed const *list, int count, int width, int height )
+{
+  Animation *a = ( Animation * ) calloc( 1, sizeof( Animation ) );
+  if ( a == NULL )
+    return NULL;
+
+  int tilesWide = ( width + TILE - 1 ) / TILE;
+  int tilesHigh = ( height + TILE - 1 ) / TILE;
+  int tiles = tilesWide * tilesHigh;
+
+  a->width = width;
+  a->height = height;
+  a->tilesWide = tilesWide;
+  a->tilesHigh = tilesHigh;
+  a->count = count;
+  a->list = ( Seed * ) malloc( count * sizeof( Seed ) );
+  a->frozen = ( Seed * ) malloc( count * sizeof( Seed ) );
+  a->moved = ( bool * ) calloc( count, sizeof( bool ) );
+  a->movedList = ( int * ) malloc( count * sizeof( int ) );
+  a->labels = ( int * ) malloc( ( long ) width * height * sizeof( int ) );
+  a->reach = ( double * ) malloc( tiles * sizeof( double ) );
+  a->seenOld = ( int * ) calloc( tiles, sizeof( int ) );
+  a->seenNew = ( int * ) calloc( tiles, sizeof( int ) );
+  a->touched = ( int * ) malloc( tiles * sizeof( int ) );
+  a->queue = ( int * ) malloc( tiles * sizeof( int ) );
+
+  if ( !a->list || !a->frozen || !a->moved || !a->movedList || !a->labels ||
+       !a->reach || !a->seenOld || !a->seenNew || !a->touched || !a->queue ) {
+    freeAnimation( a );
+    return NULL;
+  }
+
+  memcpy( a->list, list, count * sizeof( Seed ) );
+  memcpy( a->frozen, list, count * sizeof( Seed ) );
+  a->tree = buildTree( a->frozen, count );
+  if ( a->tree == NULL ) {
+    freeAnimation( a );
+    return NULL;
+  }
+
+  for ( int row = 0; row < height; row++ ) {
+    int owner = NO_OWNER;
+    for ( int col = 0; col < width; col++ )
+      owner = a->labels[ ( long ) row * width + col ] = ownerOf( a, col, row, owner );
+  }
+
+  for ( int t = 0; t < tiles; t++ )
+    updateReach( a, t );
+
+  return a;
+}
+
+void moveSeed( Animation *a, int k, double x, double y )
+{
+  Seed old = a->list[ k ];
+  initSeed( &a->list[ k ], x, y );
+
+  if ( !a->moved[ k ] ) {
+    a->moved[ k ] = true;
+    a->movedList[ a->movedCount++ ] = k;
+  }
+
+  // Find the tiles either region can reach, then relabel them.
+  a->frame++;
+  a->touchedCount = 0;
+  flood( a, &old, false );
+  flood( a, &a->list[ k ], true );
+
+  for ( int i = 0; i < a->touchedCount; i++ )
+    relabelTile( a, a->touched[ i ], k );
+  for ( int i = 0; i < a->touchedCount; i++ )
+    updateReach( a, a->touched[ i ] );
+
+  // Once enough seeds have moved, checking them one by one costs more
+  // than a new tree.
+  if ( a->movedCount > MOVED_LIMIT ) {
+    freeTree( a->tree );
+    memcpy( a->frozen, a->list, a->count * sizeof( Seed ) );
+    a->tree = buildTree( a->frozen, a->count );
+    for ( int i = 0; i < a->movedCount; i++ )
+      a->moved[ a->movedList[ i ] ] = false;
+    a->movedCount = 0;
+  }
+}
+
+void freeAnimation( Animation *a )
+{
+  if ( a->tree )
+    freeTree( a->tree );
+  free( a->list );
+  free( a->frozen );
+  free( a->moved );
+  free( a->movedList );
+  free( a->labels );
+  free( a->reach );
+  free( a->seenOld );
+  free( a->seenNew );
+  free( a->touched );
+  free( a->queue );
+  free( a );
+}
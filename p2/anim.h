@@ -0,0 +1,88 @@
+/**
+    @file anim.h
+    @author Nicholas Board (ndboard)
+
+    Contains the incremental renderer used for animation.  It keeps
+    every pixel's owner between frames, and when a seed moves it only
+    relabels the tiles that the seed's old or new region can reach.
+*/
+
+#ifndef _ANIM_H_
+#define _ANIM_H_
+
+#include "seed.h"
+#include "kdtree.h"
+
+/** Width and height of the tiles the canvas is split into. */
+#define TILE 16
+
+/** State of an animated diagram. */
+typedef struct {
+  /** Size of the canvas, and how many tiles it has each way. */
+  int width;
+  int height;
+  int tilesWide;
+  int tilesHigh;
+
+  /** Where the seeds are now. */
+  int count;
+  Seed *list;
+
+  /** Where the seeds were when the tree was last built. */
+  Seed *frozen;
+  KDTree *tree;
+
+  /** Seeds that have moved since the tree was built, which the tree
+      skips and which are checked one by one instead. */
+  bool *moved;
+  int *movedList;
+  int movedCount;
+
+  /** Owner of every pixel, row by row. */
+  int *labels;
+
+  /** For each tile, the largest distance from a pixel to its owner. */
+  double *reach;
+
+  /** The frame when each tile was last reached from a seed's old
+      position, and from its new position. */
+  int *seenOld;
+  int *seenNew;
+  int frame;
+
+  /** Tiles relabeled by the last move, and a queue for finding them. */
+  int *touched;
+  int touchedCount;
+  int *queue;
+} Animation;
+
+/**
+    Starts an animation, labeling every pixel for the given seeds.
+
+    @param list The starting seeds, which are copied.
+    @param count The number of seeds.
+    @param width The width of the canvas.
+    @param height The height of the canvas.
+    @return The new animation, or NULL if it can't be allocated.
+*/
+Animation *startAnimation( Seed const *list, int count, int width, int height );
+
+/**
+    Moves a seed and relabels the pixels whose owner can change.
+    Afterward, touched lists the tiles that were relabeled.
+
+    @param a The animation.
+    @param k The index of the seed to move.
+    @param x The new x coordinate of the seed.
+    @param y The new y coordinate of the seed.
+*/
+void moveSeed( Animation *a, int k, double x, double y );
+
+/**
+    Frees an animation's allocated space.
+
+    @param a The animation to free.
+*/
+void freeAnimation( Animation *a );
+
+#endif
@@ -0,0 +1,149 @@
+/**
+    @file edt.c
+    @author Nicholas Board (ndboard)
+
+    Labels rows with an exact Euclidean distance transform.  Along
+    a row, each seed's squared distance is a parabola in x, and the
+    owners are read off the lower envelope of those parabolas, which
+    is built in one sweep over the seeds sorted by x.
+
+    Every row sweeps every seed, so an image costs O(H (n + W)).
+    That beats a tree search per pixel once rows are wider than the
+    seeds are many, but it still grows with the seed count.  A true
+    two-pass transform would first find each column's nearest seed,
+    which only works for seeds on whole pixels and can't keep the
+    lowest index on ties, so it isn't done here.
+*/
+
+#include<stdlib.h>
+#include"edt.h"
+
+/** The seeds, for the sorting comparison. */
+static Seed const *sortList;
+
+/**
+    Orders seed indices by x coordinate, then by index.
+
+    @param a Pointer to the first index.
+    @param b Pointer to the second index.
+    @return Negative, zero or positive like strcmp.
+*/
+static int compareX( void const *a, void const *b )
+{
+  int i = *( int const * ) a;
+  int j = *( int const * ) b;
+
+  if ( sortList[ i ].x != sortList[ j ].x )
+    return sortList[ i ].x < sortList[ j ].x ? -1 : 1;
+  return i - j;
+}
+
+Transform *buildTransform( KDTree const *tree )
+{
+  Transform *e = ( Transform * ) malloc( sizeof( Transform ) );
+  if ( e == NULL )
+    return NULL;
+
+  int n = tree->count;
+  e->tree = tree;
+  e->byX = ( int * ) malloc( n * sizeof( int ) );
+  e->hull = ( int * ) malloc( n * sizeof( int ) );
+  e->from = ( double * ) malloc( n * sizeof( double ) );
+  if ( e->byX == NULL || e->hull == NULL || e->from == NULL ) {
+    freeTransform( e );
+    return NULL;
+  }
+
+  for ( int i = 0; i < n; i++ )
+    e->byX[ i ] = i;
+
+  sortList = tree->list;
+  qsort( e->byX, n, sizeof( int ), compareX );
+  return e;
+}
+
+void freeTransform( Transform *e )
+{
+  free( e->byX );
+  free( e->hull );
+  free( e->from );
+  free( e );
+}
+
+void transformRow( Transform *e, int row, int width, int *owners )
+{
+  Seed const *list = e->tree->list;
+  int n = e->tree->count;
+  int k = -1;
+
+  // Build the lower envelope of ( x - sx )^2 + ( row - sy )^2.
+  for ( int i = 0; i < n; i++ ) {
+    int q = e->byX[ i ];
+    double qy = row - list[ q ].y;
+    double fq = qy * qy + list[ q ].x * list[ q ].x;
+    double s = -INFINITY;
+    bool covered = false;
+
+    while ( k >= 0 ) {
+      int v = e->hull[ k ];
+      double vy = row - list[ v ].y;
+      double fv = vy * vy + list[ v ].x * list[ v ].x;
+
+      // Seeds in the same column: the one nearer the row covers the other.
+      if ( list[ v ].x == list[ q ].x ) {
+        if ( fq < fv ) {
+          k--;
+          continue;
+        }
+        covered = true;
+        break;
+      }
+
+      s = ( fq - fv ) / ( 2 * ( list[ q ].x - list[ v ].x ) );
+      if ( s > e->from[ k ] )
+        break;
+      k--;
+      s = -INFINITY;
+    }
+
+    if ( !covered ) {
+      k++;
+      e->hull[ k ] = q;
+      e->from[ k ] = s;
+    }
+  }
+
+  // Walk the envelope along the row.  Rounding can put a pixel on the
+  // wrong side of a breakpoint, so the neighboring seeds are checked too,
+  // and anything tied or white is settled by the tree.
+  int j = 0;
+  for ( int col = 0; col < width; col++ ) {
+    while ( j < k && e->from[ j + 1 ] <= col )
+      j++;
+
+    double best = INFINITY;
+    int owner = NO_OWNER;
+    bool tied = false;
+    for ( int t = j - 1; t <= j + 1; t++ ) {
+      if ( t < 0 || t > k )
+        continue;
+
+      int c = e->hull[ t ];
+      double dx = col - list[ c ].x;
+      double dy = row - list[ c ].y;
+      double d = dx * dx + dy * dy;
+
+      if ( d < best ) {
+        best = d;
+        owner = c;
+        tied = false;
+      } else if ( d == best ) {
+        tied = true;
+      }
+    }
+
+    if ( tied || ( list[ owner ].col == col && list[ owner ].row == row ) )
+      owner = nearestInTree( e->tree, col, row, owner );
+    owners[ col ] = owner;
+  }
+}
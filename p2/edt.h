@@ -0,0 +1,58 @@
+/**
+    @file edt.h
+    @author Nicholas Board (ndboard)
+
+    Contains the distance transform engine, which labels a whole
+    row of pixels from the lower envelope of the seeds' distance
+    parabolas instead of searching once per pixel.
+*/
+
+#ifndef _EDT_H_
+#define _EDT_H_
+
+#include "seed.h"
+#include "kdtree.h"
+
+/** State for labeling rows by distance transform. */
+typedef struct {
+  /** Tree over the seeds, used to settle ties and seed pixels. */
+  KDTree const *tree;
+
+  /** Seed indices sorted by x coordinate. */
+  int *byX;
+
+  /** Seeds on the lower envelope of the current row, left to right. */
+  int *hull;
+
+  /** The x coordinate where each envelope seed starts to be closest. */
+  double *from;
+} Transform;
+
+/**
+    Prepares to label rows for the seeds in the given tree.
+
+    @param tree Tree over the seeds, which has to outlive the transform.
+    @return The new transform, or NULL if it can't be allocated.
+*/
+Transform *buildTransform( KDTree const *tree );
+
+/**
+    Frees a transform's allocated space.
+
+    @param e The transform to free.
+*/
+void freeTransform( Transform *e );
+
+/**
+    Labels one row with the owner of each pixel.  This takes
+    O( n + width ) time for n seeds, and gives the same owners
+    as nearestInTree().
+
+    @param e The transform.
+    @param row The row to label.
+    @param width The number of pixels in the row.
+    @param owners Filled with the owner of each pixel.
+*/
+void transformRow( Transform *e, int row, int width, int *owners );
+
+#endif
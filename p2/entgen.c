@@ -0,0 +1,198 @@
+/**
+  @file entgen.c
+  @file Nicholas Board (ndboard)
+
+  This program builds the table of HTML entities the highlighter
+  checks and decodes them with.  It reads the names and code points
+  from entities.txt and writes entities.h, a perfect hash: each name
+  hashes to a bucket, and each bucket gets a seed that sends its
+  names to empty slots of the table.  Looking a name up is then one
+  hash, a mix and one comparison, with no probing.
+*/
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<stdbool.h>
+#include"entity.h"
+
+// Define the exit numbers.
+#define INPUT_EXIT 1
+#define HASH_EXIT 1
+
+// Sizes of the table.  Both are powers of two, so they can be masked.
+#define MAX_ENTITIES 4096
+#define BUCKETS 512
+#define SLOTS 4096
+#define MAX_SEED 65535
+
+// Longest a line or a name can be.
+#define LINE_LENGTH 128
+#define TEXT_LENGTH 16
+
+/** An entity read from the list. */
+typedef struct {
+  /** The name, without the & and ;. */
+  char name[ LINE_LENGTH ];
+
+  /** The text it stands for, in UTF-8. */
+  char text[ TEXT_LENGTH ];
+
+  /** Its hash, and the bucket that picks. */
+  unsigned hash;
+  int bucket;
+} Entity;
+
+// The entities, and the ones in each bucket.
+static Entity entities[ MAX_ENTITIES ];
+static int bucketSizes[ BUCKETS ];
+static int bucketOrder[ BUCKETS ];
+
+// Where each slot's entity is, or -1, and each bucket's seed.
+static int slots[ SLOTS ];
+static unsigned seeds[ BUCKETS ];
+
+/**
+  Orders buckets from the most names to the fewest, so the hardest
+  ones are placed while the table is still empty.
+
+  @param a One bucket.
+  @param b The other bucket.
+  @return Less than zero if a goes first.
+*/
+static int byBucketSize( void const *a, void const *b )
+{
+  int i = *( int const * ) a;
+  int j = *( int const * ) b;
+  if ( bucketSizes[ i ] != bucketSizes[ j ] )
+    return bucketSizes[ j ] - bucketSizes[ i ];
+  return i - j;
+}
+
+/**
+  Tries a seed for a bucket, placing its names if they all land in
+  different empty slots.
+
+  @param bucket The bucket.
+  @param seed The seed to try.
+  @param count The number of entities.
+  @return True if the names were placed.
+*/
+static bool placeBucket( int bucket, unsigned seed, int count )
+{
+  int placed[ MAX_ENTITIES ];
+  int n = 0;
+  for ( int i = 0; i < count; i++ ) {
+    if ( entities[ i ].bucket != bucket )
+      continue;
+
+    int slot = entitySlot( entities[ i ].hash, seed ) & ( SLOTS - 1 );
+    if ( slots[ slot ] >= 0 ) {
+      // Takes back the ones already placed.
+      for ( int j = 0; j < n; j++ )
+        slots[ placed[ j ] ] = -1;
+      return false;
+    }
+
+    slots[ slot ] = i;
+    placed[ n++ ] = slot;
+  }
+  return true;
+}
+
+/**
+  Where the program begins.
+
+  @return program exit status
+*/
+int main( void )
+{
+  // Reads a name and its code points from each line.
+  char line[ LINE_LENGTH ];
+  int count = 0;
+  size_t longest = 0;
+  while ( fgets( line, LINE_LENGTH, stdin ) != NULL ) {
+    if ( line[ 0 ] == '#' || line[ 0 ] == '\n' )
+      continue;
+
+    Entity *e = &entities[ count ];
+    char *rest = line;
+    int len;
+    if ( count == MAX_ENTITIES || sscanf( rest, "%s%n", e->name, &len ) != 1 ) {
+      fprintf( stderr, "Invalid entity list\n" );
+      return INPUT_EXIT;
+    }
+
+    unsigned code;
+    int used;
+    size_t textLen = 0;
+    rest += len;
+    while ( textLen + 4 < TEXT_LENGTH && sscanf( rest, "%x%n", &code, &used ) == 1 &&
+            code <= 0x10FFFF ) {
+      textLen += encodeUtf8( code, e->text + textLen );
+      rest += used;
+    }
+    e->text[ textLen ] = '\0';
+
+    if ( textLen == 0 ) {
+      fprintf( stderr, "Invalid entity list\n" );
+      return INPUT_EXIT;
+    }
+
+    if ( strlen( e->name ) > longest )
+      longest = strlen( e->name );
+    e->hash = entityHash( e->name, strlen( e->name ) );
+    e->bucket = e->hash & ( BUCKETS - 1 );
+    bucketSizes[ e->bucket ]++;
+    count++;
+  }
+
+  // Finds a seed for each bucket, the biggest first.
+  for ( int s = 0; s < SLOTS; s++ )
+    slots[ s ] = -1;
+  for ( int b = 0; b < BUCKETS; b++ )
+    bucketOrder[ b ] = b;
+  qsort( bucketOrder, BUCKETS, sizeof( int ), byBucketSize );
+
+  for ( int i = 0; i < BUCKETS; i++ ) {
+    int b = bucketOrder[ i ];
+    unsigned seed = 1;
+    while ( seed <= MAX_SEED && !placeBucket( b, seed, count ) )
+      seed++;
+    if ( seed > MAX_SEED ) {
+      fprintf( stderr, "No perfect hash for the entities\n" );
+      return HASH_EXIT;
+    }
+    seeds[ b ] = seed;
+  }
+
+  printf( "/*\n    entities.h, written by entgen from entities.txt.  Don't edit\n"
+          "    it, edit the list or entgen.c and build it again.\n*/\n\n" );
+  printf( "#ifndef _ENTITIES_H_\n#define _ENTITIES_H_\n\n#include \"entity.h\"\n\n" );
+  printf( "#define ENTITY_COUNT %d\n#define ENTITY_LONGEST %zu\n", count, longest );
+  printf( "#define ENTITY_BUCKETS %d\n#define ENTITY_SLOTS %d\n\n", BUCKETS, SLOTS );
+
+  printf( "static unsigned short const entitySeeds[ ENTITY_BUCKETS ] = {" );
+  for ( int b = 0; b < BUCKETS; b++ )
+    printf( "%s%u,", b % 12 == 0 ? "\n  " : " ", seeds[ b ] );
+  printf( "\n};\n\n" );
+
+  printf( "static EntitySlot const entitySlots[ ENTITY_SLOTS ] = {\n" );
+  for ( int s = 0; s < SLOTS; s++ ) {
+    if ( slots[ s ] < 0 )
+      continue;
+    Entity const *e = &entities[ slots[ s ] ];
+    printf( "  [ %d ] = { \"%s\", %zu, %zu, \"", s, e->name, strlen( e->name ),
+            strlen( e->text ) );
+    for ( char const *t = e->text; *t; t++ )
+      printf( "\\x%02X", ( unsigned char ) *t );
+    printf( "\" },\n" );
+  }
+  printf( "};\n\n#endif\n" );
+
+  if ( fflush( stdout ) != 0 || ferror( stdout ) )
+    return HASH_EXIT;
+
+  // Exits the program successfully.
+  return 0;
+}
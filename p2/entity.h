@@ -0,0 +1,121 @@
+/**
+    @file entity.h
+    @author Nicholas Board (ndboard)
+
+    Contains what's shared by entgen, which builds the perfect hash
+    table of HTML entities in entities.h, and the highlighter, which
+    looks entities up in it: the hash, and the UTF-8 encoding of the
+    text they stand for.  A name is hashed once, and the low bits of
+    the hash pick a bucket.  Its slot in the table comes from mixing
+    the hash with the bucket's seed, so the name is only read once.
+*/
+
+#ifndef _ENTITY_H_
+#define _ENTITY_H_
+
+#include <stddef.h>
+
+/** A slot of the table, empty if the name is NULL. */
+typedef struct {
+  /** The name, without the & and ;, and its length. */
+  char const *name;
+  unsigned char nameLen;
+
+  /** The text it stands for, in UTF-8, and its length. */
+  unsigned char textLen;
+  char const *text;
+} EntitySlot;
+
+/** Where the hash of a name starts, before its first byte. */
+#define ENTITY_HASH_START 2166136261u
+
+/**
+    Adds a byte of a name to its hash, FNV-1a.  This is separate so a
+    name can be hashed while its end is still being looked for.
+
+    @param h The hash so far.
+    @param b The next byte.
+    @return The hash with the byte added.
+*/
+static inline unsigned entityHashByte( unsigned h, char b )
+{
+  return ( h ^ ( unsigned char ) b ) * 16777619u;
+}
+
+/**
+    Finishes the hash of a name, mixing it so the low bits depend on
+    every byte.
+
+    @param h The hash of all the bytes.
+    @return The hash.
+*/
+static inline unsigned entityHashEnd( unsigned h )
+{
+  h ^= h >> 15;
+  h *= 0x2c1b3c6du;
+  h ^= h >> 12;
+  return h;
+}
+
+/**
+    Hashes the whole name of an entity.
+
+    @param name The name, without the & and ;.
+    @param len The length of the name.
+    @return The hash.
+*/
+static inline unsigned entityHash( char const *name, size_t len )
+{
+  unsigned h = ENTITY_HASH_START;
+  for ( size_t i = 0; i < len; i++ )
+    h = entityHashByte( h, name[ i ] );
+  return entityHashEnd( h );
+}
+
+/**
+    Picks the slot for a hash, given its bucket's seed.
+
+    @param hash The hash of the name.
+    @param seed The seed of the bucket the hash falls in.
+    @return A number to mask down to a slot.
+*/
+static inline unsigned entitySlot( unsigned hash, unsigned seed )
+{
+  unsigned h = ( hash ^ seed * 0x9e3779b9u ) >> 9;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13;
+  return h;
+}
+
+/**
+    Writes a code point in UTF-8.
+
+    @param code The code point, at most 0x10FFFF.
+    @param text Filled with up to four bytes, not terminated.
+    @return The number of bytes.
+*/
+static inline int encodeUtf8( unsigned code, char *text )
+{
+  if ( code < 0x80 ) {
+    text[ 0 ] = code;
+    return 1;
+  }
+  if ( code < 0x800 ) {
+    text[ 0 ] = 0xC0 | code >> 6;
+    text[ 1 ] = 0x80 | ( code & 0x3F );
+    return 2;
+  }
+  if ( code < 0x10000 ) {
+    text[ 0 ] = 0xE0 | code >> 12;
+    text[ 1 ] = 0x80 | ( code >> 6 & 0x3F );
+    text[ 2 ] = 0x80 | ( code & 0x3F );
+    return 3;
+  }
+  text[ 0 ] = 0xF0 | code >> 18;
+  text[ 1 ] = 0x80 | ( code >> 12 & 0x3F );
+  text[ 2 ] = 0x80 | ( code >> 6 & 0x3F );
+  text[ 3 ] = 0x80 | ( code & 0x3F );
+  return 4;
+}
+
+#endif
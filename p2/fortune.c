@@ -0,0 +1,712 @@
+/**
+    @file fortune.c
+    @author Nicholas Board (ndboard)
+
+    Computes the diagram's edges with Fortune's sweep.  A line sweeps
+    down the plane in y, and the beach line of parabolic arcs just
+    behind it is kept in a treap, so the arc above a new seed is found
+    in O( log n ) time.  Breakpoints between arcs trace out the edges,
+    and circle events, kept in a heap, mark where an arc vanishes and
+    a vertex is made.
+*/
+
+#include<stdlib.h>
+#include<string.h>
+#include"fortune.h"
+
+/** Starting capacity of the growable lists. */
+#define INIT_CAP 64
+
+/** Edges shorter than this fraction of the box are left out. */
+#define SHORTEST 1e-9
+
+/** An arc of the beach line, which is also a node of the treap. */
+typedef struct ArcTag {
+  /** The seed whose parabola this arc is part of. */
+  int site;
+
+  /** Neighbors along the beach line. */
+  struct ArcTag *prev;
+  struct ArcTag *next;
+
+  /** Links and priority in the treap. */
+  struct ArcTag *left;
+  struct ArcTag *right;
+  struct ArcTag *parent;
+  unsigned priority;
+
+  /** The edge traced by the breakpoint with the next arc. */
+  int edge;
+
+  /** The pending event where this arc vanishes, or NULL. */
+  struct EventTag *event;
+} Arc;
+
+/** A circle event, where an arc shrinks away to nothing. */
+typedef struct EventTag {
+  /** Where the sweep line is when the event happens. */
+  double y;
+
+  /** The vertex made by the event, at the center of the circle. */
+  double cx;
+  double cy;
+
+  /** The arc that vanishes, or NULL once the event is cancelled. */
+  Arc *arc;
+} Event;
+
+/** An edge being traced, as the points s + t * d for t from t0 to t1. */
+typedef struct {
+  double sx;
+  double sy;
+  double dx;
+  double dy;
+  double t0;
+  double t1;
+  int left;
+  int right;
+
+  /** The other half of an edge that starts at a seed, traced the
+      other way from the same point, or -1. */
+  int twin;
+} Edge;
+
+/** Everything the sweep works with. */
+typedef struct {
+  Seed const *list;
+  Arc *root;
+  unsigned random;
+
+  /** Heap of circle events, ordered by y. */
+  Event **heap;
+  int heapCount;
+  int heapCap;
+
+  /** Edges traced so far. */
+  Edge *edges;
+  int edgeCount;
+  int edgeCap;
+
+  /** Whether anything failed to allocate. */
+  bool failed;
+} Sweep;
+
+/** The seeds, for the sorting comparison. */
+static Seed const *sortList;
+
+/**
+    Orders seed indices by y, then x, then index.
+
+    @param a Pointer to the first index.
+    @param b Pointer to the second index.
+    @return Negative, zero or positive like strcmp.
+*/
+static int compareSites( void const *a, void const *b )
+{
+  int i = *( int const * ) a;
+  int j = *( int const * ) b;
+
+  if ( sortList[ i ].y != sortList[ j ].y )
+    return sortList[ i ].y < sortList[ j ].y ? -1 : 1;
+  if ( sortList[ i ].x != sortList[ j ].x )
+    return sortList[ i ].x < sortList[ j ].x ? -1 : 1;
+  return i - j;
+}
+
+/**
+    Finds the breakpoint between two arcs.
+
+    @param p The seed of the arc on the left.
+    @param q The seed of the arc on the right.
+    @param l Where the sweep line is.
+    @return The x coordinate of the breakpoint.
+*/
+static double breakpoint( Seed const *p, Seed const *q, double l )
+{
+  // A parabola whose seed is on the sweep line is just a vertical ray.
+  if ( p->y == l )
+    return p->x;
+  if ( q->y == l )
+    return q->x;
+  if ( p->y == q->y )
+    return ( p->x + q->x ) / 2;
+
+  // Solve a x^2 + b x + c = 0 for where the parabolas cross.
+  double dp = 2 * ( p->y - l );
+  double dq = 2 * ( q->y - l );
+  double a = 1 / dp - 1 / dq;
+  double b = -2 * ( p->x / dp - q->x / dq );
+  double c = ( p->x * p->x + p->y * p->y - l * l ) / dp
+           - ( q->x * q->x + q->y * q->y - l * l ) / dq;
+  double disc = b * b - 4 * a * c;
+  double root = sqrt( disc > 0 ? disc : 0 );
+
+  // Of the two crossings, the breakpoint is where p is on top to the
+  // left.  The newer seed's arc is the narrower one, so it's the left
+  // crossing when q is newer and the right one when p is.
+  double x1 = ( -b - root ) / ( 2 * a );
+  double x2 = ( -b + root ) / ( 2 * a );
+  double lo = x1 < x2 ? x1 : x2;
+  double hi = x1 < x2 ? x2 : x1;
+  return p->y < q->y ? lo : hi;
+}
+
+/**
+    Gets the height of an arc's parabola at an x coordinate.
+
+    @param p The arc's seed.
+    @param x The x coordinate.
+    @param l Where the sweep line is.
+    @return The y coordinate of the parabola.
+*/
+static double parabolaAt( Seed const *p, double x, double l )
+{
+  return ( ( x - p->x ) * ( x - p->x ) + p->y * p->y - l * l ) / ( 2 * ( p->y - l ) );
+}
+
+/**
+    Starts tracing a new edge.
+
+    @param s The sweep.
+    @param left The seed on the left of the breakpoint.
+    @param right The seed on the right of the breakpoint.
+    @param x The x coordinate the edge starts at.
+    @param y The y coordinate the edge starts at.
+    @param t0 Zero, or -INFINITY if the edge comes in from infinitely far.
+    @return The index of the edge.
+*/
+static int startEdge( Sweep *s, int left, int right, double x, double y, double t0 )
+{
+  if ( s->edgeCount >= s->edgeCap ) {
+    Edge *grown = ( Edge * ) realloc( s->edges, 2 * s->edgeCap * sizeof( Edge ) );
+    if ( grown == NULL ) {
+      s->failed = true;
+      return -1;
+    }
+    s->edges = grown;
+    s->edgeCap *= 2;
+  }
+
+  // The breakpoint moves along the bisector, this way as the sweep goes on.
+  Edge *e = &s->edges[ s->edgeCount ];
+  e->sx = x;
+  e->sy = y;
+  e->dx = s->list[ left ].y - s->list[ right ].y;
+  e->dy = s->list[ right ].x - s->list[ left ].x;
+  e->t0 = t0;
+  e->t1 = INFINITY;
+  e->left = left;
+  e->right = right;
+  e->twin = -1;
+  return s->edgeCount++;
+}
+
+/**
+    Ends an edge at a vertex.
+
+    @param s The sweep.
+    @param edge The index of the edge, or -1.
+    @param x The x coordinate of the vertex.
+    @param y The y coordinate of the vertex.
+*/
+static void endEdge( Sweep *s, int edge, double x, double y )
+{
+  if ( edge < 0 )
+    return;
+
+  Edge *e = &s->edges[ edge ];
+  e->t1 = ( ( x - e->sx ) * e->dx + ( y - e->sy ) * e->dy ) / ( e->dx * e->dx + e->dy * e->dy );
+}
+
+/**
+    Swaps two events in the heap.
+
+    @param s The sweep.
+    @param i The first position.
+    @param j The second position.
+*/
+static void swapEvents( Sweep *s, int i, int j )
+{
+  Event *tmp = s->heap[ i ];
+  s->heap[ i ] = s->heap[ j ];
+  s->heap[ j ] = tmp;
+}
+
+/**
+    Adds an event to the heap.
+
+    @param s The sweep.
+    @param ev The event.
+*/
+static void pushEvent( Sweep *s, Event *ev )
+{
+  if ( s->heapCount >= s->heapCap ) {
+    Event **grown = ( Event ** ) realloc( s->heap, 2 * s->heapCap * sizeof( Event * ) );
+    if ( grown == NULL ) {
+      s->failed = true;
+      free( ev );
+      return;
+    }
+    s->heap = grown;
+    s->heapCap *= 2;
+  }
+
+  int i = s->heapCount++;
+  s->heap[ i ] = ev;
+  while ( i > 0 && s->heap[ ( i - 1 ) / 2 ]->y > s->heap[ i ]->y ) {
+    swapEvents( s, i, ( i - 1 ) / 2 );
+    i = ( i - 1 ) / 2;
+  }
+}
+
+/**
+    Removes the earliest event from the heap.
+
+    @param s The sweep.
+    @return The earliest event.
+*/
+static Event *popEvent( Sweep *s )
+{
+  Event *top = s->heap[ 0 ];
+  s->heap[ 0 ] = s->heap[ --s->heapCount ];
+
+  int i = 0;
+  while ( true ) {
+    int small = i;
+    int l = 2 * i + 1;
+    int r = 2 * i + 2;
+    if ( l < s->heapCount && s->heap[ l ]->y < s->heap[ small ]->y )
+      small = l;
+    if ( r < s->heapCount && s->heap[ r ]->y < s->heap[ small ]->y )
+      small = r;
+    if ( small == i )
+      break;
+    swapEvents( s, i, small );
+    i = small;
+  }
+
+  return top;
+}
+
+/**
+    Cancels an arc's pending circle event, if it has one.  The event
+    stays in the heap and is skipped when it comes up.
+
+    @param a The arc.
+*/
+static void cancelEvent( Arc *a )
+{
+  if ( a->event ) {
+    a->event->arc = NULL;
+    a->event = NULL;
+  }
+}
+
+/**
+    Schedules the event where an arc vanishes, if its neighbors'
+    breakpoints are closing in on it.
+
+    @param s The sweep.
+    @param b The arc.
+    @param l Where the sweep line is.
+*/
+static void checkCircle( Sweep *s, Arc *b, double l )
+{
+  if ( b->prev == NULL || b->next == NULL )
+    return;
+
+  Seed const *pa = &s->list[ b->prev->site ];
+  Seed const *pb = &s->list[ b->site ];
+  Seed const *pc = &s->list[ b->next->site ];
+
+  // The breakpoints only meet if the seeds turn this way.
+  double bx = pb->x - pa->x;
+  double by = pb->y - pa->y;
+  double cx = pc->x - pa->x;
+  double cy = pc->y - pa->y;
+  double cross = bx * ( pc->y - pb->y ) - by * ( pc->x - pb->x );
+  if ( cross <= 0 )
+    return;
+
+  // Center of the circle through the three seeds.
+  double d = 2 * ( bx * cy - by * cx );
+  double b2 = bx * bx + by * by;
+  double c2 = cx * cx + cy * cy;
+  double ux = ( cy * b2 - by * c2 ) / d;
+  double uy = ( bx * c2 - cx * b2 ) / d;
+
+  Event *ev = ( Event * ) malloc( sizeof( Event ) );
+  if ( ev == NULL ) {
+    s->failed = true;
+    return;
+  }
+
+  ev->cx = pa->x + ux;
+  ev->cy = pa->y + uy;
+  ev->y = ev->cy + sqrt( ux * ux + uy * uy );
+  if ( ev->y < l )
+    ev->y = l;
+  ev->arc = b;
+  b->event = ev;
+  pushEvent( s, ev );
+}
+
+/**
+    Makes a new arc.
+
+    @param s The sweep.
+    @param site The arc's seed.
+    @return The new arc, or NULL if it can't be allocated.
+*/
+static Arc *newArc( Sweep *s, int site )
+{
+  Arc *a = ( Arc * ) calloc( 1, sizeof( Arc ) );
+  if ( a == NULL ) {
+    s->failed = true;
+    return NULL;
+  }
+
+  // A small linear congruential generator is plenty for priorities.
+  s->random = s->random * 1103515245 + 12345;
+  a->priority = s->random;
+  a->site = site;
+  a->edge = -1;
+  return a;
+}
+
+/**
+    Points whatever held the old child of a node at a new one.
+
+    @param s The sweep.
+    @param parent The parent, or NULL if the old child was the root.
+    @param old The old child.
+    @param child The new child.
+*/
+static void replaceChild( Sweep *s, Arc *parent, Arc *old, Arc *child )
+{
+  if ( parent == NULL )
+    s->root = child;
+  else if ( parent->left == old )
+    parent->left = child;
+  else
+    parent->right = child;
+
+  if ( child )
+    child->parent = parent;
+}
+
+/**
+    Rotates a node up above its parent.
+
+    @param s The sweep.
+    @param a The node.
+*/
+static void rotateUp( Sweep *s, Arc *a )
+{
+  Arc *p = a->parent;
+  replaceChild( s, p->parent, p, a );
+
+  if ( p->left == a ) {
+    p->left = a->right;
+    if ( a->right )
+      a->right->parent = p;
+    a->right = p;
+  } else {
+    p->right = a->left;
+    if ( a->left )
+      a->left->parent = p;
+    a->left = p;
+  }
+  p->parent = a;
+}
+
+/**
+    Puts a new arc just after another along the beach line.
+
+    @param s The sweep.
+    @param a The arc to insert after.
+    @param n The new arc.
+*/
+static void insertAfter( Sweep *s, Arc *a, Arc *n )
+{
+  n->prev = a;
+  n->next = a->next;
+  if ( a->next )
+    a->next->prev = n;
+  a->next = n;
+
+  // The in-order successor slot is either a's right child, or the
+  // left child of the first node in a's right subtree.
+  if ( a->right == NULL ) {
+    a->right = n;
+    n->parent = a;
+  } else {
+    Arc *t = a->right;
+    while ( t->left )
+      t = t->left;
+    t->left = n;
+    n->parent = t;
+  }
+
+  while ( n->parent && n->parent->priority < n->priority )
+    rotateUp( s, n );
+}
+
+/**
+    Takes an arc out of the beach line and frees it.
+
+    @param s The sweep.
+    @param a The arc.
+*/
+static void removeArc( Sweep *s, Arc *a )
+{
+  if ( a->prev )
+    a->prev->next = a->next;
+  if ( a->next )
+    a->next->prev = a->prev;
+
+  // Rotate it down to a leaf, then cut it off.
+  while ( a->left || a->right ) {
+    Arc *c = a->left == NULL ? a->right
+           : a->right == NULL ? a->left
+           : a->left->priority > a->right->priority ? a->left : a->right;
+    rotateUp( s, c );
+  }
+  replaceChild( s, a->parent, a, NULL );
+
+  cancelEvent( a );
+  free( a );
+}
+
+/**
+    Finds the arc above an x coordinate.
+
+    @param s The sweep.
+    @param x The x coordinate.
+    @param l Where the sweep line is.
+    @return The arc.
+*/
+static Arc *arcAbove( Sweep *s, double x, double l )
+{
+  Arc *a = s->root;
+
+  while ( true ) {
+    if ( a->prev && x < breakpoint( &s->list[ a->prev->site ], &s->list[ a->site ], l ) )
+      a = a->left;
+    else if ( a->next && x > breakpoint( &s->list[ a->site ], &s->list[ a->next->site ], l ) )
+      a = a->right;
+    else
+      return a;
+  }
+}
+
+/**
+    Adds a seed's arc to the beach line.
+
+    @param s The sweep.
+    @param site The seed.
+*/
+static void addSite( Sweep *s, int site )
+{
+  Seed const *p = &s->list[ site ];
+  Arc *n = newArc( s, site );
+  if ( n == NULL )
+    return;
+
+  if ( s->root == NULL ) {
+    s->root = n;
+    return;
+  }
+
+  Arc *a = arcAbove( s, p->x, p->y );
+  Seed const *q = &s->list[ a->site ];
+
+  // Seeds in the first row have flat arcs, so the new one goes beside
+  // the old one, with a vertical edge between them from far above.
+  if ( q->y == p->y ) {
+    insertAfter( s, a, n );
+    n->edge = a->edge;
+    a->edge = startEdge( s, a->site, site, ( q->x + p->x ) / 2, p->y, -INFINITY );
+    return;
+  }
+
+  // Otherwise the arc above is split in two around the new one.
+  Arc *split = newArc( s, a->site );
+  if ( split == NULL ) {
+    free( n );
+    return;
+  }
+
+  cancelEvent( a );
+  split->edge = a->edge;
+  insertAfter( s, a, n );
+  insertAfter( s, n, split );
+
+  double y = parabolaAt( q, p->x, p->y );
+  a->edge = startEdge( s, a->site, site, p->x, y, 0 );
+  n->edge = startEdge( s, site, a->site, p->x, y, 0 );
+
+  // The two breakpoints trace one edge, in opposite directions from
+  // where it starts, so the halves are joined when it's clipped.
+  if ( a->edge >= 0 && n->edge >= 0 ) {
+    s->edges[ a->edge ].twin = n->edge;
+    s->edges[ n->edge ].twin = a->edge;
+  }
+
+  checkCircle( s, a, p->y );
+  checkCircle( s, split, p->y );
+}
+
+/**
+    Handles a circle event, where an arc vanishes and its two
+    breakpoints meet at a vertex.
+
+    @param s The sweep.
+    @param ev The event.
+*/
+static void removeAt( Sweep *s, Event *ev )
+{
+  Arc *b = ev->arc;
+  Arc *a = b->prev;
+  Arc *c = b->next;
+
+  endEdge( s, a->edge, ev->cx, ev->cy );
+  endEdge( s, b->edge, ev->cx, ev->cy );
+
+  cancelEvent( a );
+  cancelEvent( c );
+  b->event = NULL;
+  removeArc( s, b );
+
+  a->edge = startEdge( s, a->site, c->site, ev->cx, ev->cy, 0 );
+  checkCircle( s, a, ev->y );
+  checkCircle( s, c, ev->y );
+}
+
+/**
+    Clips an edge to a box, with Liang-Barsky clipping.
+
+    @param e The edge.
+    @param x0 The left side of the box.
+    @param y0 The top of the box.
+    @param x1 The right side of the box.
+    @param y1 The bottom of the box.
+    @param seg Filled with the clipped edge.
+    @return True if any of the edge is inside the box.
+*/
+static bool clip( Edge const *e, double x0, double y0, double x1, double y1, Segment *seg )
+{
+  double lo = e->t0;
+  double hi = e->t1;
+  double p[ 4 ] = { -e->dx, e->dx, -e->dy, e->dy };
+  double q[ 4 ] = { e->sx - x0, x1 - e->sx, e->sy - y0, y1 - e->sy };
+
+  for ( int i = 0; i < 4; i++ ) {
+    if ( p[ i ] == 0 ) {
+      if ( q[ i ] < 0 )
+        return false;
+    } else {
+      double t = q[ i ] / p[ i ];
+      if ( p[ i ] < 0 && t > lo )
+        lo = t;
+      if ( p[ i ] > 0 && t < hi )
+        hi = t;
+    }
+  }
+
+  if ( !( lo < hi ) )
+    return false;
+
+  seg->x1 = e->sx + lo * e->dx;
+  seg->y1 = e->sy + lo * e->dy;
+  seg->x2 = e->sx + hi * e->dx;
+  seg->y2 = e->sy + hi * e->dy;
+
+  // A seed right under a breakpoint makes an arc that vanishes as soon
+  // as it's made, leaving an edge with no length worth drawing.
+  if ( fabs( seg->x2 - seg->x1 ) + fabs( seg->y2 - seg->y1 ) <= SHORTEST * ( x1 - x0 + y1 - y0 ) )
+    return false;
+  seg->left = e->left;
+  seg->right = e->right;
+  return true;
+}
+
+/**
+    Frees the arcs of a subtree.
+
+    @param a The root of the subtree.
+*/
+static void freeArcs( Arc *a )
+{
+  if ( a == NULL )
+    return;
+  freeArcs( a->left );
+  freeArcs( a->right );
+  free( a );
+}
+
+int sweepEdges( Seed const *list, int count, double x0, double y0,
+                double x1, double y1, Segment **segs )
+{
+  Sweep s;
+  memset( &s, 0, sizeof( s ) );
+  s.list = list;
+  s.random = 230;
+  s.heapCap = INIT_CAP;
+  s.edgeCap = INIT_CAP;
+  s.heap = ( Event ** ) malloc( s.heapCap * sizeof( Event * ) );
+  s.edges = ( Edge * ) malloc( s.edgeCap * sizeof( Edge ) );
+
+  int *order = ( int * ) malloc( count * sizeof( int ) );
+  s.failed = s.heap == NULL || s.edges == NULL || order == NULL;
+
+  if ( !s.failed ) {
+    for ( int i = 0; i < count; i++ )
+      order[ i ] = i;
+    sortList = list;
+    qsort( order, count, sizeof( int ), compareSites );
+  }
+
+  // Take seeds in sweep order, handling any circle events that come
+  // first.  A repeated seed is skipped, since it owns nothing.
+  int next = 0;
+  while ( !s.failed && ( next < count || s.heapCount > 0 ) ) {
+    if ( s.heapCount > 0 && ( next >= count || s.heap[ 0 ]->y < list[ order[ next ] ].y ) ) {
+      Event *ev = popEvent( &s );
+      if ( ev->arc )
+        removeAt( &s, ev );
+      free( ev );
+    } else {
+      int site = order[ next++ ];
+      if ( next < 2 || list[ site ].x != list[ order[ next - 2 ] ].x ||
+           list[ site ].y != list[ order[ next - 2 ] ].y )
+        addSite( &s, site );
+    }
+  }
+
+  // Clip what was traced.  Edges never ended run off to infinity.
+  // The second half of a split edge runs back along the first, so it
+  // extends the first one backward instead of being clipped on its own.
+  int clipped = 0;
+  Segment *out = s.failed ? NULL : ( Segment * ) malloc( ( s.edgeCount + 1 ) * sizeof( Segment ) );
+  for ( int i = 0; out && i < s.edgeCount; i++ ) {
+    Edge e = s.edges[ i ];
+    if ( e.twin >= 0 ) {
+      if ( e.twin < i )
+        continue;
+      e.t0 = -s.edges[ e.twin ].t1;
+    }
+    if ( clip( &e, x0, y0, x1, y1, &out[ clipped ] ) )
+      clipped++;
+  }
+
+  while ( s.heapCount > 0 )
+    free( popEvent( &s ) );
+  freeArcs( s.root );
+  free( s.heap );
+  free( s.edges );
+  free( order );
+
+  *segs = out;
+  return out ? clipped : -1;
+}
@@ -0,0 +1,44 @@
+/**
+    @file fortune.h
+    @author Nicholas Board (ndboard)
+
+    Contains the vector engine, which computes the edges of the
+    diagram with Fortune's sweep instead of labeling pixels.
+*/
+
+#ifndef _FORTUNE_H_
+#define _FORTUNE_H_
+
+#include "seed.h"
+
+/** An edge of the diagram, clipped to a box. */
+typedef struct {
+  /** The two ends of the edge. */
+  double x1;
+  double y1;
+  double x2;
+  double y2;
+
+  /** The seeds on either side of the edge. */
+  int left;
+  int right;
+} Segment;
+
+/**
+    Computes the edges of the diagram in O( n log n ) time for n
+    seeds, and clips them to the given box.  Seeds at the same spot
+    as an earlier seed own nothing, so they're left out.
+
+    @param list The seeds.
+    @param count The number of seeds.
+    @param x0 The left side of the box.
+    @param y0 The top of the box.
+    @param x1 The right side of the box.
+    @param y1 The bottom of the box.
+    @param segs Set to a new list of edges, which the caller frees.
+    @return The number of edges, or -1 if there isn't enough memory.
+*/
+int sweepEdges( Seed const *list, int count, double x0, double y0,
+                double x1, double y1, Segment **segs );
+
+#endif
@@ -0,0 +1,824 @@
+/**
+    @file highlight.c
+    @author Nicholas Board (ndboard)
+
+    The scanner is a table-driven state machine, with a move for
+    every state and byte.  It knows comments and CDATA sections, so
+    a '>' inside one doesn't end it, quoted attribute values, and
+    the bodies of script and style elements, where nothing is markup
+    until the closing tag.  Runs of bytes that leave the state as it
+    is are skipped 32 bytes at a time with SSE2, so text between
+    tags costs about as much as a memchr.
+
+    Each style of output gets its own copy of the scanning loop, so
+    the loop never checks which one it's writing.  The ANSI styles
+    only differ in their codes, which come from a table.
+
+    When entities are checked, each one is looked up at its '&', in
+    the perfect hash table entgen generates.  Whether it's known
+    picks the state it goes into, so the state alone still says how
+    the rest of it is shown.
+*/
+
+#include<string.h>
+#include<strings.h>
+#include<pthread.h>
+#include"highlight.h"
+#include"entities.h"
+
+#ifdef __SSE2__
+#include<emmintrin.h>
+#endif
+
+// Define the color escape codes.
+#define RED "\x1B[31m"
+#define BLUE "\x1B[34m"
+#define YELLOW "\x1B[33m"
+#define GREEN "\x1B[32m"
+#define MAGENTA "\x1B[35m"
+#define BLACK "\x1B[0m"
+
+// Longest code written between two runs.
+#define CODE_MAX 48
+
+// Bytes that end a tag or attribute name.
+#define SPACES " \t\n\r\f"
+
+// Bytes held back from the end of a feed.
+#define KEEP ( HIGHLIGHT_LOOKAHEAD - 1 )
+
+// Longest text an entity can stand for.
+#define ENTITY_TEXT 8
+
+/** Colors a byte can be shown in.  Hidden bytes aren't written at
+    all, like the rest of an entity after its decoded text. */
+typedef enum {
+  NO_COLOR, TAG_COLOR, ENTITY_COLOR, NAME_COLOR, VALUE_COLOR, BAD_ENTITY_COLOR, HIDDEN_COLOR,
+  COLORS
+} Color;
+
+// Flags on the color of a move.  A closing move resets the color
+// after its byte, and a move that looks ahead is only taken if the
+// closing tag of a script or style body starts there.  A checking
+// move starts an entity, which may be looked up.
+#define COLOR_MASK 7
+#define CLOSING 8
+#define LOOK 16
+#define CHECK 32
+
+/** Parts of a tag after its name, a set of these for each body. */
+typedef enum {
+  BETWEEN, ATTR_NAME, ATTR_EQUALS, ATTR_DOUBLE, ATTR_SINGLE, ATTR_BARE, ATTR_QUOTED, PARTS
+} Part;
+
+/**
+  What the scanner is in the middle of.  The three bodies come
+  first, so a body is also the number of its set of tag states.
+  The ranges spell out words a byte at a time, like "<![CDATA[".
+  Entities that are checked go to BAD_ENTITY if they're unknown,
+  and to DECODED if they're known and written as their text.
+*/
+enum {
+  TEXT, SCRIPT, STYLE, BODIES,
+  ENTITY = BODIES, BAD_ENTITY, DECODED, OPEN, TAG_NAME,
+  SCRIPT_OPEN, SCRIPT_NAMED = SCRIPT_OPEN + 5,
+  STYLE_OPEN, STYLE_NAMED = STYLE_OPEN + 3,
+  BANG, BANG_DASH, CDATA_OPEN, CDATA_OPENED = CDATA_OPEN + 5,
+  COMMENT, COMMENT_DASH, COMMENT_DASHES,
+  CDATA, CDATA_BRACKET, CDATA_BRACKETS,
+  TAGS, STATES = TAGS + BODIES * PARTS
+};
+
+/** A state of the scanner. */
+typedef HighlightState State;
+
+// Makes the build fail if the header's count of states is wrong.
+typedef char statesMatch[ STATES == HIGHLIGHT_STATES ? 1 : -1 ];
+
+// And if the whole of the longest entity can't be seen from its '&'.
+typedef char entitiesFit[ HIGHLIGHT_LOOKAHEAD >= ENTITY_LONGEST + 2 ? 1 : -1 ];
+
+/** What the scanner does with one byte. */
+typedef struct {
+  /** The state it goes to. */
+  unsigned char next;
+
+  /** The color the byte is shown in, with the flags above. */
+  unsigned char paint;
+} Move;
+
+// The scanner's tables, filled in once by buildScanner().
+static Move moves[ STATES ][ 256 ];
+static Color colors[ STATES ];
+static bool skips[ STATES ];
+static char stops[ STATES ][ 2 ];
+static pthread_once_t built = PTHREAD_ONCE_INIT;
+
+/** The code written between runs of two colors. */
+typedef struct {
+  /** The bytes of the code. */
+  char text[ CODE_MAX ];
+
+  /** The number of bytes. */
+  size_t len;
+} Code;
+
+// Codes that start each color in each style, the first going back
+// to no color, and codes that end a color before the next one.
+static char const *const starts[ HIGHLIGHT_STYLES ][ COLORS ] = {
+  { BLACK, RED, BLUE, YELLOW, GREEN, MAGENTA, "" },
+  { BLACK, "\x1B[38;5;203m", "\x1B[38;5;75m", "\x1B[38;5;221m", "\x1B[38;5;114m",
+    "\x1B[38;5;201m", "" },
+  { BLACK, "\x1B[38;2;230;80;80m", "\x1B[38;2;90;160;255m", "\x1B[38;2;230;200;90m",
+    "\x1B[38;2;120;200;120m", "\x1B[38;2;230;60;230m", "" },
+  { "", "<span class=\"tag\">", "<span class=\"entity\">", "<span class=\"name\">",
+    "<span class=\"value\">", "<span class=\"bad-entity\">", "" },
+  { "", "", "", "", "", "", "" }
+};
+static char const *const ends[ HIGHLIGHT_STYLES ] = { "", "", "", "</span>", "" };
+
+// Text that has to be escaped in HTML output.
+static char const *const escapes[ 256 ] = {
+  [ '<' ] = "&lt;", [ '>' ] = "&gt;", [ '&' ] = "&amp;"
+};
+
+/** How a copy of walkBlock() writes its output. */
+typedef enum { LEXING, CODING, ESCAPING } Writing;
+
+// The code between each pair of colors in each style, filled in by
+// buildScanner() from the ones above.
+static Code changes[ HIGHLIGHT_STYLES ][ COLORS ][ COLORS ];
+
+/**
+    Gets the state for part of a tag.
+
+    @param body The body the tag goes back to once it's closed.
+    @param part The part of the tag.
+    @return The state.
+*/
+static State tagState( int body, Part part )
+{
+  return TAGS + body * PARTS + part;
+}
+
+/**
+    Moves from a state to another on every byte, showing them in the
+    color of the state they lead to.
+
+    @param from The state to move from.
+    @param to The state to move to.
+*/
+static void moveAll( State from, State to )
+{
+  for ( int b = 0; b < 256; b++ )
+    moves[ from ][ b ] = ( Move ) { to, colors[ to ] };
+}
+
+/**
+    Moves from a state to another on each of some bytes, showing them
+    in the color of the state they lead to.
+
+    @param from The state to move from.
+    @param bytes The bytes to move on.
+    @param to The state to move to.
+*/
+static void moveOn( State from, char const *bytes, State to )
+{
+  for ( ; *bytes; bytes++ )
+    moves[ from ][ ( unsigned char ) *bytes ] = ( Move ) { to, colors[ to ] };
+}
+
+/**
+    Closes a tag, comment or entity on a byte.
+
+    @param from The state to move from.
+    @param bytes The bytes that close it.
+    @param to The state to go back to.
+    @param paint The color to show the closing byte in.
+*/
+static void closeOn( State from, char const *bytes, State to, Color paint )
+{
+  for ( ; *bytes; bytes++ )
+    moves[ from ][ ( unsigned char ) *bytes ] = ( Move ) { to, paint | CLOSING };
+}
+
+/**
+    Makes a state part of a tag's name, which ends at a space or '>'.
+
+    @param state The state.
+*/
+static void nameState( State state )
+{
+  moveAll( state, TAG_NAME );
+  moveOn( state, SPACES, tagState( TEXT, BETWEEN ) );
+  closeOn( state, ">", TEXT, TAG_COLOR );
+}
+
+/**
+    Spells out a word from a state, a byte at a time through the
+    states starting at first.
+
+    @param from The state before the word.
+    @param word The word.
+    @param first The state after its first letter.
+    @param anyCase True if letters match in either case.
+*/
+static void spell( State from, char const *word, State first, bool anyCase )
+{
+  for ( int i = 0; word[ i ]; i++ ) {
+    char letter[] = { word[ i ], anyCase ? word[ i ] - 'a' + 'A' : '\0', '\0' };
+    moveOn( i == 0 ? from : first + i - 1, letter, first + i );
+  }
+}
+
+/**
+    Fills in the moves for the tag states that go back to one body.
+
+    @param body The body.
+*/
+static void tagStates( int body )
+{
+  State between = tagState( body, BETWEEN );
+  State name = tagState( body, ATTR_NAME );
+  State equals = tagState( body, ATTR_EQUALS );
+  State doubled = tagState( body, ATTR_DOUBLE );
+  State single = tagState( body, ATTR_SINGLE );
+  State bare = tagState( body, ATTR_BARE );
+  State quoted = tagState( body, ATTR_QUOTED );
+
+  // Between attributes, and right after a quoted value.
+  for ( State s = between; s <= quoted; s += quoted - between ) {
+    moveAll( s, name );
+    moveOn( s, SPACES "/", between );
+    moveOn( s, "=", equals );
+    moveOn( s, "\"", doubled );
+    moveOn( s, "'", single );
+    closeOn( s, ">", body, TAG_COLOR );
+  }
+
+  moveAll( name, name );
+  moveOn( name, SPACES "/", between );
+  moveOn( name, "=", equals );
+  closeOn( name, ">", body, TAG_COLOR );
+
+  moveAll( equals, bare );
+  moveOn( equals, SPACES, equals );
+  moveOn( equals, "\"", doubled );
+  moveOn( equals, "'", single );
+  closeOn( equals, ">", body, TAG_COLOR );
+
+  moveAll( doubled, doubled );
+  moveOn( doubled, "\"", quoted );
+  moveAll( single, single );
+  moveOn( single, "'", quoted );
+
+  moveAll( bare, bare );
+  moveOn( bare, SPACES, between );
+  closeOn( bare, ">", body, TAG_COLOR );
+}
+
+/**
+    Fills in the scanner's tables.  Every state is shown in one color,
+    and each move shows its byte in the color of the state it leads
+    to, except for closing moves.  So the color a state is entered
+    with is always the color it shows, which is what lets the scanner
+    pick up from any state.
+*/
+static void buildScanner( void )
+{
+  for ( State s = 0; s < STATES; s++ )
+    colors[ s ] = s < BODIES ? NO_COLOR : TAG_COLOR;
+  colors[ ENTITY ] = ENTITY_COLOR;
+  colors[ BAD_ENTITY ] = BAD_ENTITY_COLOR;
+  colors[ DECODED ] = HIDDEN_COLOR;
+  for ( int body = TEXT; body < BODIES; body++ ) {
+    colors[ tagState( body, ATTR_NAME ) ] = NAME_COLOR;
+    for ( Part p = ATTR_DOUBLE; p <= ATTR_QUOTED; p++ )
+      colors[ tagState( body, p ) ] = VALUE_COLOR;
+  }
+
+  moveAll( TEXT, TEXT );
+  moveOn( TEXT, "<", OPEN );
+  moveOn( TEXT, "&", ENTITY );
+  moves[ TEXT ][ '&' ].paint |= CHECK;
+
+  for ( State s = ENTITY; s <= DECODED; s++ ) {
+    moveAll( s, s );
+    closeOn( s, ";", TEXT, colors[ s ] );
+  }
+
+  // Nothing in a script or style body is markup but its closing tag.
+  for ( int body = SCRIPT; body < BODIES; body++ ) {
+    moveAll( body, body );
+    moves[ body ][ '<' ] = ( Move ) { TAG_NAME, TAG_COLOR | LOOK };
+  }
+
+  // Tag names, watching for the ones that start something else.
+  for ( State s = OPEN; s <= CDATA_OPENED; s++ )
+    nameState( s );
+  moveOn( OPEN, "!", BANG );
+  spell( OPEN, "script", SCRIPT_OPEN, true );
+  spell( SCRIPT_OPEN, "tyle", STYLE_OPEN, true );
+  for ( int body = SCRIPT; body < BODIES; body++ ) {
+    State named = body == SCRIPT ? SCRIPT_NAMED : STYLE_NAMED;
+    moveOn( named, SPACES "/", tagState( body, BETWEEN ) );
+    closeOn( named, ">", body, TAG_COLOR );
+  }
+
+  moveOn( BANG, "-", BANG_DASH );
+  moveOn( BANG_DASH, "-", COMMENT );
+  spell( BANG, "[CDATA", CDATA_OPEN, false );
+  moveOn( CDATA_OPENED, "[", CDATA );
+
+  // Comments end at "-->" and CDATA at "]]>".
+  for ( State s = COMMENT; s <= CDATA; s += CDATA - COMMENT ) {
+    char const *mark = s == COMMENT ? "-" : "]";
+    moveAll( s, s );
+    moveOn( s, mark, s + 1 );
+    moveAll( s + 1, s );
+    moveOn( s + 1, mark, s + 2 );
+    moveAll( s + 2, s );
+    moveOn( s + 2, mark, s + 2 );
+    closeOn( s + 2, ">", TEXT, TAG_COLOR );
+  }
+
+  for ( int body = TEXT; body < BODIES; body++ )
+    tagStates( body );
+
+  // Where only one or two bytes leave a state, runs of the rest can be
+  // skipped over.
+  for ( State s = 0; s < STATES; s++ ) {
+    int found = 0;
+    for ( int b = 0; b < 256; b++ ) {
+      Move m = moves[ s ][ b ];
+      if ( m.next != s || m.paint != colors[ s ] ) {
+        if ( found < 2 )
+          stops[ s ][ found ] = b;
+        found++;
+      }
+    }
+
+    skips[ s ] = found == 1 || found == 2;
+    if ( found == 1 )
+      stops[ s ][ 1 ] = stops[ s ][ 0 ];
+  }
+
+  // A change of color ends the one before, if there was one, and
+  // starts the next.  Hidden bytes come and go without a code.
+  for ( int style = 0; style < HIGHLIGHT_STYLES; style++ )
+    for ( Color from = NO_COLOR; from < COLORS; from++ )
+      for ( Color to = NO_COLOR; to < COLORS; to++ ) {
+        Code *code = &changes[ style ][ from ][ to ];
+        code->text[ 0 ] = '\0';
+        if ( from != HIDDEN_COLOR && to != HIDDEN_COLOR ) {
+          strcpy( code->text, from == NO_COLOR ? "" : ends[ style ] );
+          strcat( code->text, starts[ style ][ to ] );
+        }
+        code->len = strlen( code->text );
+      }
+}
+
+/**
+    Hands bytes to the sink's writer, unless it has already failed.
+
+    @param sink The sink.
+    @param bytes The bytes to write.
+    @param len The number of bytes.
+*/
+static void writeSink( HighlightSink *sink, char const *bytes, size_t len )
+{
+  if ( !sink->failed && len > 0 && sink->write( sink->ctx, bytes, len ) != 0 )
+    sink->failed = true;
+}
+
+/**
+    Adds bytes that don't fit in the buffer, or are long enough to
+    go straight to the writer, after what's already waiting.
+
+    @param sink The sink.
+    @param bytes The bytes to add.
+    @param len The number of bytes.
+*/
+static void emitLong( HighlightSink *sink, char const *bytes, size_t len )
+{
+  flushSink( sink );
+
+  if ( len >= sink->direct || len > HIGHLIGHT_BUFFER ) {
+    writeSink( sink, bytes, len );
+    return;
+  }
+
+  memcpy( sink->buffer, bytes, len );
+  sink->len = len;
+}
+
+/**
+    Adds bytes to the output.  This is called for every run between
+    color changes, so the usual case of room in the buffer is kept
+    inline.
+
+    @param sink The sink.
+    @param bytes The bytes to add.
+    @param len The number of bytes.
+*/
+static inline void emit( HighlightSink *sink, char const *bytes, size_t len )
+{
+  if ( len >= sink->direct || sink->len + len > HIGHLIGHT_BUFFER ) {
+    emitLong( sink, bytes, len );
+    return;
+  }
+
+  memcpy( sink->buffer + sink->len, bytes, len );
+  sink->len += len;
+}
+
+/**
+    Adds text to HTML output, escaping the bytes that would be taken
+    for markup.
+
+    @param sink The sink.
+    @param bytes The text to add.
+    @param len The number of bytes.
+*/
+static void emitEscaped( HighlightSink *sink, char const *bytes, size_t len )
+{
+  char const *end = bytes + len;
+  char const *run = bytes;
+  for ( char const *pos = bytes; pos < end; pos++ ) {
+    char const *escape = escapes[ ( unsigned char ) *pos ];
+    if ( escape != NULL ) {
+      emit( sink, run, pos - run );
+      emit( sink, escape, strlen( escape ) );
+      run = pos + 1;
+    }
+  }
+
+  emit( sink, run, end - run );
+}
+
+/**
+    Adds a run of input to the output, the way a copy of walkBlock()
+    writes it.
+
+    @param sink The sink.
+    @param bytes The run.
+    @param len The number of bytes.
+    @param writing How the output is written, never LEXING.
+*/
+static inline void emitRun( HighlightSink *sink, char const *bytes, size_t len,
+                            Writing writing )
+{
+  if ( writing == ESCAPING )
+    emitEscaped( sink, bytes, len );
+  else
+    emit( sink, bytes, len );
+}
+
+/**
+    Finds the first of either of two bytes, 32 bytes at a time with
+    SSE2 where it's available.
+
+    @param pos Where to start looking.
+    @param end Where to stop looking.
+    @param a One byte to look for.
+    @param b The other byte to look for.
+    @return The first one found, or end if there are none.
+*/
+static inline char const *findEither( char const *pos, char const *end, char a, char b )
+{
+#ifdef __SSE2__
+  __m128i va = _mm_set1_epi8( a );
+  __m128i vb = _mm_set1_epi8( b );
+  while ( end - pos >= 32 ) {
+    __m128i lo = _mm_loadu_si128( ( __m128i const * ) pos );
+    __m128i hi = _mm_loadu_si128( ( __m128i const * ) ( pos + 16 ) );
+    unsigned found = _mm_movemask_epi8( _mm_or_si128( _mm_cmpeq_epi8( lo, va ),
+                                                      _mm_cmpeq_epi8( lo, vb ) ) ) |
+                     _mm_movemask_epi8( _mm_or_si128( _mm_cmpeq_epi8( hi, va ),
+                                                      _mm_cmpeq_epi8( hi, vb ) ) ) << 16;
+    if ( found )
+      return pos + __builtin_ctz( found );
+    pos += 32;
+  }
+#endif
+
+  while ( pos < end && *pos != a && *pos != b )
+    pos++;
+  return pos;
+}
+
+/**
+    Checks if a '<' in a script or style body starts its closing tag.
+
+    @param body The body, SCRIPT or STYLE.
+    @param pos The '<'.
+    @param limit How far the input can be read.
+    @return True if the closing tag starts here.
+*/
+static bool closesBody( State body, char const *pos, char const *limit )
+{
+  char const *name = body == SCRIPT ? "script" : "style";
+  size_t len = strlen( name );
+
+  return ( size_t ) ( limit - pos ) > len + 2 && pos[ 1 ] == '/' &&
+         strncasecmp( pos + 2, name, len ) == 0 && pos[ len + 2 ] != '\0' &&
+         strchr( SPACES "/>", pos[ len + 2 ] ) != NULL;
+}
+
+/**
+    Reads a numeric character reference, like "#169" or "#x2014".
+
+    @param digits The digits, after the '#'.
+    @param len The number of digits.
+    @param text Filled with the character in UTF-8.
+    @return The length of the text, or -1 if it isn't a character.
+*/
+static int decodeNumber( char const *digits, size_t len, char *text )
+{
+  unsigned base = 10;
+  if ( len > 0 && ( digits[ 0 ] == 'x' || digits[ 0 ] == 'X' ) ) {
+    base = 16;
+    digits++;
+    len--;
+  }
+  if ( len == 0 )
+    return -1;
+
+  unsigned long code = 0;
+  for ( size_t i = 0; i < len; i++ ) {
+    char c = digits[ i ];
+    unsigned digit = c >= '0' && c <= '9' ? c - '0' :
+                     c >= 'a' && c <= 'f' ? c - 'a' + 10 :
+                     c >= 'A' && c <= 'F' ? c - 'A' + 10 : base;
+    if ( digit >= base )
+      return -1;
+    code = code * base + digit;
+    if ( code > 0x10FFFF )
+      return -1;
+  }
+
+  if ( code == 0 || ( code >= 0xD800 && code <= 0xDFFF ) )
+    return -1;
+  return encodeUtf8( code, text );
+}
+
+/**
+    Looks up the entity that starts at a '&'.  The whole of any known
+    entity can be seen from there, so one without a ';' in sight is
+    unknown.  The name is hashed on the way to its ';'.
+
+    @param pos The '&'.
+    @param limit How far the input can be read.
+    @param text Filled with the text the entity stands for.
+    @return The length of the text, or -1 if it isn't known.
+*/
+static int decodeEntity( char const *pos, char const *limit, char *text )
+{
+  char const *name = pos + 1;
+  char const *seen = limit - pos < HIGHLIGHT_LOOKAHEAD ? limit : pos + HIGHLIGHT_LOOKAHEAD;
+  char const *semi = name;
+  unsigned hash = ENTITY_HASH_START;
+  while ( semi < seen && *semi != ';' )
+    hash = entityHashByte( hash, *semi++ );
+  if ( semi == seen || semi == name )
+    return -1;
+
+  size_t len = semi - name;
+  if ( name[ 0 ] == '#' )
+    return decodeNumber( name + 1, len - 1, text );
+
+  hash = entityHashEnd( hash );
+  unsigned seed = entitySeeds[ hash & ( ENTITY_BUCKETS - 1 ) ];
+  EntitySlot const *slot = &entitySlots[ entitySlot( hash, seed ) & ( ENTITY_SLOTS - 1 ) ];
+  if ( slot->nameLen != len || memcmp( slot->name, name, len ) != 0 )
+    return -1;
+
+  memcpy( text, slot->text, slot->textLen );
+  return slot->textLen;
+}
+
+/**
+    Walks through a block of input, optionally coloring it.  Bytes are
+    written in runs of one color, with a code from the sink's style
+    between runs.  In a state with a run to skip, the next byte that
+    could end it is found with findEither(); other bytes take a move
+    each from the table.  It's inlined into the callers below, so
+    each gets a copy that writes its output one way, or not at all.
+    Through walkEntities(), the default of keeping entities as they
+    are gets copies that never look them up; the others share one.
+
+    @param state What the scanner was in the middle of at the start.
+    @param pos The start of the block.
+    @param end The end of the block.
+    @param limit How far the input can be read, looking ahead.  This
+                 is either the end of the input or at least
+                 HIGHLIGHT_LOOKAHEAD - 1 bytes past the end of the
+                 block.
+    @param sink Where to send the output.
+    @param writing How to write the output, if at all.
+    @param entities What's done with entities.
+    @return What the scanner is in the middle of at the end.
+*/
+static inline State walkBlock( State state, char const *pos, char const *end,
+                               char const *limit, HighlightSink *sink, Writing writing,
+                               int entities )
+{
+  // Start of the bytes waiting to be written, in the color shown.
+  char const *run = pos;
+  Color shown = colors[ state ];
+  Code const ( *change )[ COLORS ] = writing == LEXING ? NULL : changes[ sink->style ];
+
+  while ( pos < end ) {
+    if ( skips[ state ] ) {
+      pos = findEither( pos, end, stops[ state ][ 0 ], stops[ state ][ 1 ] );
+      if ( pos == end )
+        break;
+    }
+
+    // Most moves keep the color, and only change the state.
+    Move m = moves[ state ][ ( unsigned char ) *pos ];
+    if ( m.paint == shown ) {
+      state = m.next;
+      pos++;
+      continue;
+    }
+
+    if ( ( m.paint & LOOK ) && !closesBody( state, pos, limit ) ) {
+      pos++;
+      continue;
+    }
+
+    // Decoded entities are written as their text right away, and the
+    // rest of them hidden.
+    if ( ( m.paint & CHECK ) && entities != HIGHLIGHT_KEEP_ENTITIES ) {
+      char text[ ENTITY_TEXT ];
+      int len = decodeEntity( pos, limit, text );
+      if ( len < 0 ) {
+        m = ( Move ) { BAD_ENTITY, BAD_ENTITY_COLOR };
+      } else if ( entities == HIGHLIGHT_DECODE_ENTITIES ) {
+        if ( writing != LEXING ) {
+          emitRun( sink, run, pos - run, writing );
+          emit( sink, change[ shown ][ ENTITY_COLOR ].text, change[ shown ][ ENTITY_COLOR ].len );
+          emitRun( sink, text, len, writing );
+          emit( sink, change[ ENTITY_COLOR ][ shown ].text, change[ ENTITY_COLOR ][ shown ].len );
+        }
+        run = pos;
+        m = ( Move ) { DECODED, HIDDEN_COLOR };
+      }
+    }
+
+    Color paint = m.paint & COLOR_MASK;
+    if ( paint != shown ) {
+      if ( writing != LEXING ) {
+        if ( pos > run && ( entities != HIGHLIGHT_DECODE_ENTITIES || shown != HIDDEN_COLOR ) )
+          emitRun( sink, run, pos - run, writing );
+        emit( sink, change[ shown ][ paint ].text, change[ shown ][ paint ].len );
+      }
+      run = pos;
+      shown = paint;
+    }
+
+    pos++;
+    state = m.next;
+    if ( m.paint & CLOSING ) {
+      if ( writing != LEXING ) {
+        if ( entities != HIGHLIGHT_DECODE_ENTITIES || shown != HIDDEN_COLOR )
+          emitRun( sink, run, pos - run, writing );
+        emit( sink, change[ shown ][ NO_COLOR ].text, change[ shown ][ NO_COLOR ].len );
+      }
+      run = pos;
+      shown = NO_COLOR;
+    }
+  }
+
+  if ( writing != LEXING && pos > run &&
+       ( entities != HIGHLIGHT_DECODE_ENTITIES || shown != HIDDEN_COLOR ) )
+    emitRun( sink, run, pos - run, writing );
+  return state;
+}
+
+/**
+    Walks through a block of input with a copy of walkBlock() for
+    what's done with entities.  Keeping them is the usual case, with
+    a copy of its own.
+
+    @param state What the scanner was in the middle of at the start.
+    @param pos The start of the block.
+    @param end The end of the block.
+    @param limit How far the input can be read, looking ahead.
+    @param sink Where to send the output.
+    @param writing How to write the output, if at all.
+    @param entities What's done with entities.
+    @return What the scanner is in the middle of at the end.
+*/
+static inline State walkEntities( State state, char const *pos, char const *end,
+                                  char const *limit, HighlightSink *sink, Writing writing,
+                                  int entities )
+{
+  if ( entities == HIGHLIGHT_KEEP_ENTITIES )
+    return walkBlock( state, pos, end, limit, sink, writing, HIGHLIGHT_KEEP_ENTITIES );
+  return walkBlock( state, pos, end, limit, sink, writing, entities );
+}
+
+HighlightState colorBlock( HighlightState state, char const *block, char const *end,
+                           char const *limit, HighlightSink *sink )
+{
+  switch ( sink->style ) {
+  case HIGHLIGHT_HTML:
+    return walkEntities( state, block, end, limit, sink, ESCAPING, sink->entities );
+  case HIGHLIGHT_PLAIN:
+    // The input goes out as it is, and only needs to be lexed, unless
+    // entities are decoded.
+    if ( sink->entities == HIGHLIGHT_DECODE_ENTITIES )
+      return walkEntities( state, block, end, limit, sink, CODING, sink->entities );
+    emit( sink, block, end - block );
+    return lexBlock( state, block, end, limit, sink->entities );
+  default:
+    return walkEntities( state, block, end, limit, sink, CODING, sink->entities );
+  }
+}
+
+HighlightState lexBlock( HighlightState state, char const *block, char const *end,
+                         char const *limit, int entities )
+{
+  return walkEntities( state, block, end, limit, NULL, LEXING, entities );
+}
+
+void initSink( HighlightSink *sink, HighlightWriter write, void *ctx )
+{
+  pthread_once( &built, buildScanner );
+  sink->write = write;
+  sink->ctx = ctx;
+  sink->direct = HIGHLIGHT_BUFFER;
+  sink->style = HIGHLIGHT_ANSI;
+  sink->entities = HIGHLIGHT_KEEP_ENTITIES;
+  sink->failed = false;
+  sink->len = 0;
+}
+
+bool flushSink( HighlightSink *sink )
+{
+  writeSink( sink, sink->buffer, sink->len );
+  sink->len = 0;
+  return !sink->failed;
+}
+
+int endColor( HighlightState state, HighlightSink *sink )
+{
+  if ( colors[ state ] != NO_COLOR ) {
+    Code const *code = &changes[ sink->style ][ colors[ state ] ][ NO_COLOR ];
+    emit( sink, code->text, code->len );
+  }
+
+  if ( state >= ENTITY && state <= DECODED )
+    return HIGHLIGHT_OPEN_ENTITY;
+  if ( colors[ state ] != NO_COLOR )
+    return HIGHLIGHT_OPEN_TAG;
+  return HIGHLIGHT_OK;
+}
+
+void initHighlighter( Highlighter *h, HighlightWriter write, void *ctx )
+{
+  h->state = HIGHLIGHT_TEXT;
+  h->kept = 0;
+  initSink( &h->sink, write, ctx );
+}
+
+int feedHighlighter( Highlighter *h, char const *bytes, size_t len )
+{
+  // The bytes held back can be scanned once there are enough after
+  // them, copied along behind them to be looked at.
+  size_t copied = len < KEEP ? len : KEEP;
+  memcpy( h->held + h->kept, bytes, copied );
+  size_t have = h->kept + copied;
+  if ( h->kept + len <= KEEP ) {
+    h->kept = have;
+    return h->sink.failed ? HIGHLIGHT_WRITE_FAILED : HIGHLIGHT_OK;
+  }
+
+  size_t ready = have - KEEP < h->kept ? have - KEEP : h->kept;
+  h->state = colorBlock( h->state, h->held, h->held + ready, h->held + have, &h->sink );
+  if ( ready < h->kept ) {
+    // The feed was too short to get past them all.
+    memmove( h->held, h->held + ready, have - ready );
+    h->kept = have - ready;
+    return h->sink.failed ? HIGHLIGHT_WRITE_FAILED : HIGHLIGHT_OK;
+  }
+
+  // Scans the feed itself, holding back its last few bytes.
+  h->state = colorBlock( h->state, bytes, bytes + len - KEEP, bytes + len, &h->sink );
+  memcpy( h->held, bytes + len - KEEP, KEEP );
+  h->kept = KEEP;
+  return h->sink.failed ? HIGHLIGHT_WRITE_FAILED : HIGHLIGHT_OK;
+}
+
+int finishHighlighter( Highlighter *h )
+{
+  h->state = colorBlock( h->state, h->held, h->held + h->kept, h->held + h->kept, &h->sink );
+  h->kept = 0;
+
+  int result = endColor( h->state, &h->sink );
+  if ( !flushSink( &h->sink ) )
+    return HIGHLIGHT_WRITE_FAILED;
+  return result;
+}
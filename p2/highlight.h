@@ -0,0 +1,214 @@
+/**
+    @file highlight.h
+    @author Nicholas Board (ndboard)
+
+    A push parser that colors HTML for a terminal or a web page, the
+    scanner behind hlight.  Input is fed in pieces of any size, and the colored
+    output goes to a callback.  Nothing is allocated and nothing
+    exits: all the state lives in the Highlighter, and problems come
+    back as result codes.
+
+    The lower-level functions at the end scan one block from a given
+    state, for callers like hlight -j that split the input up
+    themselves.
+*/
+
+#ifndef _HIGHLIGHT_H_
+#define _HIGHLIGHT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Results from feeding or finishing.
+#define HIGHLIGHT_OK 0
+#define HIGHLIGHT_OPEN_TAG 1
+#define HIGHLIGHT_OPEN_ENTITY 2
+#define HIGHLIGHT_WRITE_FAILED 3
+
+// Styles of output.  The ANSI styles color with escape codes, in the
+// basic eight colors, the 256-color palette or 24-bit color.  HTML
+// wraps markup in <span class="tag">, "entity", "bad-entity", "name"
+// or "value" and escapes the text, and plain passes the input through as it is,
+// only checking that it ends outside any markup.
+#define HIGHLIGHT_ANSI 0
+#define HIGHLIGHT_ANSI_256 1
+#define HIGHLIGHT_TRUECOLOR 2
+#define HIGHLIGHT_HTML 3
+#define HIGHLIGHT_PLAIN 4
+#define HIGHLIGHT_STYLES 5
+
+// What's done with entities.  They're only colored by default.
+// Checking looks up names in the HTML5 entity set and numbers in
+// Unicode, and shows the ones that aren't there in a color of their
+// own.  Decoding also writes the known ones as the text they stand
+// for, in the entity color.
+#define HIGHLIGHT_KEEP_ENTITIES 0
+#define HIGHLIGHT_CHECK_ENTITIES 1
+#define HIGHLIGHT_DECODE_ENTITIES 2
+
+/** Size of the buffer colored output is collected in. */
+#define HIGHLIGHT_BUFFER 65536
+
+/** Bytes that have to be visible past a byte to scan it, like the
+    rest of "</script>" after a '<' in a script body, or of the
+    longest entity after its '&'. */
+#define HIGHLIGHT_LOOKAHEAD 33
+
+/** Number of states the scanner can be in. */
+#define HIGHLIGHT_STATES 53
+
+/** The state the scanner starts in, outside any markup. */
+#define HIGHLIGHT_TEXT 0
+
+/** A state of the scanner. */
+typedef unsigned char HighlightState;
+
+/**
+    Takes some colored output.  The bytes are only good until it
+    returns.
+
+    @param ctx The context the sink was set up with.
+    @param bytes The bytes to write.
+    @param len The number of bytes.
+    @return Zero on success, anything else if they couldn't be written.
+*/
+typedef int ( *HighlightWriter )( void *ctx, char const *bytes, size_t len );
+
+/** Where colored output is collected on its way to a writer. */
+typedef struct {
+  /** The writer and its context. */
+  HighlightWriter write;
+  void *ctx;
+
+  /** Runs at least this long go straight to the writer instead of
+      being copied into the buffer.  It's HIGHLIGHT_BUFFER unless the
+      caller wants long runs of its input by reference. */
+  size_t direct;
+
+  /** The style of output, HIGHLIGHT_ANSI unless the caller picks
+      another before the first output. */
+  int style;
+
+  /** What's done with entities, HIGHLIGHT_KEEP_ENTITIES unless the
+      caller picks another before the first output. */
+  int entities;
+
+  /** True once the writer has failed.  Later output is dropped. */
+  bool failed;
+
+  /** Number of bytes waiting in the buffer. */
+  size_t len;
+
+  /** Bytes waiting to be written. */
+  char buffer[ HIGHLIGHT_BUFFER ];
+} HighlightSink;
+
+/** A push parser, carrying everything from one feed to the next. */
+typedef struct {
+  /** What the scanner is in the middle of. */
+  HighlightState state;
+
+  /** Input held back from the last feed, until the bytes after it
+      are seen, with room for a feed's worth of lookahead. */
+  char held[ 2 * ( HIGHLIGHT_LOOKAHEAD - 1 ) ];
+
+  /** Number of bytes held back. */
+  size_t kept;
+
+  /** Where the output goes. */
+  HighlightSink sink;
+} Highlighter;
+
+/**
+    Gets a highlighter ready to color a new document.
+
+    @param h The highlighter.
+    @param write Where to send the colored output.
+    @param ctx Passed along to the writer.
+*/
+void initHighlighter( Highlighter *h, HighlightWriter write, void *ctx );
+
+/**
+    Colors the next piece of a document.  A few bytes at the end may
+    be held back until the next feed, or the finish.
+
+    @param h The highlighter.
+    @param bytes The next piece of input.
+    @param len The length of the piece.
+    @return HIGHLIGHT_OK, or HIGHLIGHT_WRITE_FAILED if the writer has
+            failed.
+*/
+int feedHighlighter( Highlighter *h, char const *bytes, size_t len );
+
+/**
+    Colors what's left of a document and writes out all the output.
+    The highlighter can be initialized again for another document.
+
+    @param h The highlighter.
+    @return HIGHLIGHT_OK, HIGHLIGHT_OPEN_TAG or HIGHLIGHT_OPEN_ENTITY
+            if the document ends in the middle of one, or
+            HIGHLIGHT_WRITE_FAILED if the writer has failed.
+*/
+int finishHighlighter( Highlighter *h );
+
+/**
+    Sets up a sink for output, and makes sure the scanner's tables
+    are built.  initHighlighter() does this for its own sink.
+
+    @param sink The sink.
+    @param write Where to send the output.
+    @param ctx Passed along to the writer.
+*/
+void initSink( HighlightSink *sink, HighlightWriter write, void *ctx );
+
+/**
+    Writes out everything waiting in a sink.
+
+    @param sink The sink.
+    @return True unless the writer has failed.
+*/
+bool flushSink( HighlightSink *sink );
+
+/**
+    Colors a block of input from any state.  The tables have to be
+    built first, by initSink() or initHighlighter().
+
+    @param state What the scanner was in the middle of at the start.
+    @param block The start of the block.
+    @param end The end of the block.
+    @param limit How far the input can be read, looking ahead.  This
+                 is either the end of the input or at least
+                 HIGHLIGHT_LOOKAHEAD - 1 bytes past the end of the
+                 block.
+    @param sink Where to send the output.
+    @return What the scanner is in the middle of at the end.
+*/
+HighlightState colorBlock( HighlightState state, char const *block, char const *end,
+                           char const *limit, HighlightSink *sink );
+
+/**
+    Finds what the scanner would be in the middle of after a block of
+    input, without coloring it.
+
+    @param state What the scanner was in the middle of at the start.
+    @param block The start of the block.
+    @param end The end of the block.
+    @param limit How far the input can be read, looking ahead.
+    @param entities What's done with entities, as in the sink the
+                    block will be colored with.
+    @return What the scanner is in the middle of at the end.
+*/
+HighlightState lexBlock( HighlightState state, char const *block, char const *end,
+                         char const *limit, int entities );
+
+/**
+    Ends the output for input that stops in a state, resetting the
+    color if it's in the middle of markup.
+
+    @param state The state at the end of the input.
+    @param sink Where the output goes.
+    @return HIGHLIGHT_OK, HIGHLIGHT_OPEN_TAG or HIGHLIGHT_OPEN_ENTITY.
+*/
+int endColor( HighlightState state, HighlightSink *sink );
+
+#endif
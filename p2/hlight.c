@@ -4,118 +4,561 @@
 
   This program takes in HTML script and will
   output it will all tags colored red and all
-  entities colored blue.
+  entities colored blue.  Inside a tag, attribute
+  names are yellow and their values green.  The
+  coloring itself is done by the highlight library.
+
+  With -f, the output can be in 256 colors or 24-bit color, HTML
+  spans for a web page, or plain, which passes the input through
+  and only checks that it doesn't end inside a tag or entity.
+
+  With -e check, entities are looked up, and the ones that aren't
+  HTML5 entities or Unicode characters are shown in magenta.  With
+  -e decode, the known ones are also written as their text.
+
+  Input is read in large blocks and fed to a highlighter.  When the
+  input is a regular file it's mapped instead and fed all at once.
+  Long runs of the mapping then aren't copied: the output is
+  gathered as spans of the mapping with the highlighter's buffer
+  between them, and handed to writev a batch at a time.
+
+  With -j, the input is split into one chunk per thread.  Each
+  chunk is first lexed from every state it could start in, to
+  learn where it would end up from each.  Those are stitched
+  together in order to find the true state at the start of every
+  chunk, and then the chunks are colored in parallel and written
+  out in order.
 */
 
 #include<stdio.h>
 #include<stdlib.h>
+#include<string.h>
+#include<stdbool.h>
+#include<unistd.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<sys/uio.h>
+#include<pthread.h>
+#include"highlight.h"
 
-// Define the color escape codes and exit numbers.
-#define RED "\x1B[31m"
-#define BLUE "\x1B[34m"
-#define BLACK "\x1B[0m"
+// Define the exit numbers.
 #define UNSUCCESSFUL_TAG_EXIT 101
 #define UNSUCCESSFUL_ENTITY_EXIT 100
+#define OUTPUT_EXIT 1
+#define USAGE_EXIT 1
+#define MAX_THREADS 256
+#define MAX_STYLE_LENGTH 16
+
+// Size of the input blocks.
+#define BLOCK 65536
+
+// Number of spans gathered for one writev.
+#define SPANS 1024
+
+// Shorter runs are cheaper to copy than to gather by reference.
+#define SPAN_MIN 2048
+
+// Bytes of input each thread colors at a time with -j.
+#define CHUNK ( 4 * 1024 * 1024 )
+
+// How often a speculative lex checks whether it has caught up with
+// the one from the first state.
+#define CHECKPOINT 4096
+
+// Bytes held back from the end of a round with -j.
+#define KEEP ( HIGHLIGHT_LOOKAHEAD - 1 )
+
+// Names for the styles of output, in order.
+static char const styleNames[ HIGHLIGHT_STYLES ][ MAX_STYLE_LENGTH ] = {
+  "ansi", "256", "truecolor", "html", "plain"
+};
+
+// Names for what can be done with entities, in order.
+#define ENTITY_MODES 3
+static char const entityNames[ ENTITY_MODES ][ MAX_STYLE_LENGTH ] = {
+  "keep", "check", "decode"
+};
+
+/** Output gathered for a single writev. */
+typedef struct {
+  /** The mapped input, which spans may point into. */
+  char const *map;
+
+  /** The size of the mapping. */
+  size_t size;
+
+  /** Spans waiting to be written. */
+  struct iovec spans[ SPANS ];
+
+  /** Number of spans waiting. */
+  int count;
+} Gather;
+
+/** One thread's chunk of the input, with -j. */
+typedef struct {
+  /** The bytes of the chunk. */
+  char const *bytes;
+
+  /** The length of the chunk. */
+  size_t len;
+
+  /** How far past the chunk the scanner may look ahead. */
+  char const *limit;
+
+  /** The state the chunk ends in from each state it could start in. */
+  HighlightState ends[ HIGHLIGHT_STATES ];
+
+  /** States the first speculative lex reached at each checkpoint. */
+  HighlightState *marks;
+
+  /** The state the chunk really starts in, once it's known. */
+  HighlightState start;
+
+  /** True if the start is known before the chunk is lexed. */
+  bool known;
+
+  /** The state the chunk really ends in, once it's colored. */
+  HighlightState end;
+
+  /** The chunk colored, waiting to be written. */
+  char *colored;
+
+  /** Number of colored bytes, and room for them. */
+  size_t coloredLen;
+  size_t coloredCap;
+
+  /** Where the chunk's output goes on its way to colored. */
+  HighlightSink sink;
+} Chunk;
 
 // Prototyping functions used.
-void showTag();
-void showEntity();
+int usage( void );
+int exitStatus( int result );
+int writeAll( void *ctx, char const *bytes, size_t len );
+int gatherSpan( void *ctx, char const *bytes, size_t len );
+bool flushSpans( Gather *g );
+int colorParallel( char const *map, size_t size, int threads, int style, int entities );
 
 /**
-  Reads the input HTML file one character
-  at a time and check for the beginning of tags
-  and entities.
+  Reads the input HTML in blocks, coloring the tags and entities
+  in each one.
 
+  @param argc The number of command-line arguments.
+  @param argv The command-line arguments.
   @return program exit status
 */
-int main ()
+int main( int argc, char *argv[] )
 {
+  static char block[ BLOCK ];
+  static Highlighter h;
+  static Gather g;
+  ssize_t len;
 
-  // The current character
-  int c;
+  // Parses the number of threads, the style and what to do with
+  // entities, if given.
+  int threads = 1;
+  int style = HIGHLIGHT_ANSI;
+  int entities = HIGHLIGHT_KEEP_ENTITIES;
+  for ( int i = 1; i < argc; i += 2 ) {
+    if ( i + 1 == argc )
+      return usage();
 
-  // Continues to go through, checking for tags and entities until EOF
-  while ( ( c = getchar() ) != EOF ){
-    if ( c == '<' )
-    {
-      showTag();
+    if ( strcmp( argv[ i ], "-j" ) == 0 ) {
+      char *end;
+      long n = strtol( argv[ i + 1 ], &end, 10 );
+      if ( end == argv[ i + 1 ] || *end != '\0' || n < 1 || n > MAX_THREADS )
+        return usage();
+      threads = n;
+    } else if ( strcmp( argv[ i ], "-f" ) == 0 ) {
+      style = 0;
+      while ( style < HIGHLIGHT_STYLES && strcmp( argv[ i + 1 ], styleNames[ style ] ) != 0 )
+        style++;
+      if ( style == HIGHLIGHT_STYLES )
+        return usage();
+    } else if ( strcmp( argv[ i ], "-e" ) == 0 ) {
+      entities = 0;
+      while ( entities < ENTITY_MODES && strcmp( argv[ i + 1 ], entityNames[ entities ] ) != 0 )
+        entities++;
+      if ( entities == ENTITY_MODES )
+        return usage();
+    } else {
+      return usage();
     }
+  }
 
-    else if (c == '&' )
-    {
-      showEntity();
-    }
-    else {
-      putchar( c );
-    }
+  // A regular file can be mapped and fed all at once.
+  struct stat info;
+  char *map = MAP_FAILED;
+  if ( fstat( STDIN_FILENO, &info ) == 0 && S_ISREG( info.st_mode ) && info.st_size > 0 )
+    map = mmap( NULL, info.st_size, PROT_READ, MAP_PRIVATE, STDIN_FILENO, 0 );
+
+  if ( threads > 1 )
+    return exitStatus( colorParallel( map == MAP_FAILED ? NULL : map,
+                                      map == MAP_FAILED ? 0 : info.st_size, threads,
+                                      style, entities ) );
+
+  if ( map != MAP_FAILED ) {
+    madvise( map, info.st_size, MADV_SEQUENTIAL );
+    g.map = map;
+    g.size = info.st_size;
+    initHighlighter( &h, gatherSpan, &g );
+    h.sink.direct = SPAN_MIN;
+    h.sink.style = style;
+    h.sink.entities = entities;
+    feedHighlighter( &h, map, info.st_size );
+  } else {
+    // Continues to go through, checking for tags and entities until EOF
+    initHighlighter( &h, writeAll, NULL );
+    h.sink.style = style;
+    h.sink.entities = entities;
+    while ( ( len = read( STDIN_FILENO, block, BLOCK ) ) > 0 )
+      if ( feedHighlighter( &h, block, len ) != HIGHLIGHT_OK )
+        break;
   }
 
+  // If the EOF is reached inside a tag or entity, error is reported.
+  int result = finishHighlighter( &h );
+  if ( !flushSpans( &g ) )
+    result = HIGHLIGHT_WRITE_FAILED;
+  return exitStatus( result );
+}
+
+/**
+  Prints how to run the program.
+
+  @return The exit status for bad arguments.
+*/
+int usage( void )
+{
+  fprintf( stderr, "usage: hlight [-f ansi|256|truecolor|html|plain] [-e keep|check|decode] "
+                   "[-j <threads>]\n" );
+  return USAGE_EXIT;
+}
+
+/**
+  Gets the exit status for the result of highlighting.
+
+  @param result The result from the highlighter.
+  @return program exit status
+*/
+int exitStatus( int result )
+{
+  if ( result == HIGHLIGHT_OPEN_TAG )
+    return UNSUCCESSFUL_TAG_EXIT;
+  if ( result == HIGHLIGHT_OPEN_ENTITY )
+    return UNSUCCESSFUL_ENTITY_EXIT;
+  if ( result == HIGHLIGHT_WRITE_FAILED )
+    return OUTPUT_EXIT;
+
   // Exits the program successfully.
   return 0;
 }
 
 /**
-  Colors tags red.
+  Writes output straight to standard output.
+
+  @param ctx Unused.
+  @param bytes The bytes to write.
+  @param len The number of bytes.
+  @return Zero, or -1 if they couldn't be written.
 */
-void showTag()
+int writeAll( void *ctx, char const *bytes, size_t len )
 {
-  // The current character.
-  int c;
+  ( void ) ctx;
+  while ( len > 0 ) {
+    ssize_t n = write( STDOUT_FILENO, bytes, len );
+    if ( n < 0 )
+      return -1;
+    bytes += n;
+    len -= n;
+  }
 
-  // Starts the red text.
-  printf( "%s", RED );
+  return 0;
+}
+
+/**
+  Gathers output to be written with writev.  Runs of the mapping
+  stay put, so they're only remembered.  Anything else is the
+  highlighter's buffer, which is about to be reused, so everything
+  gathered so far is written out with it.
 
-  // Need to manually place another '<'.
-  putchar( '<' );
+  @param ctx The gathered output.
+  @param bytes The bytes to write.
+  @param len The number of bytes.
+  @return Zero, or -1 if they couldn't be written.
+*/
+int gatherSpan( void *ctx, char const *bytes, size_t len )
+{
+  Gather *g = ( Gather * ) ctx;
+  if ( g->count == SPANS && !flushSpans( g ) )
+    return -1;
 
-  // Parses through the rest of the tag until '>'
-  while ( ( c = getchar() ) != '>' ) {
+  g->spans[ g->count ].iov_base = ( char * ) bytes;
+  g->spans[ g->count ].iov_len = len;
+  g->count++;
 
-    // If the EOF is reached before the end of the tag, error is reported.
-    if ( c == -1 ) {
-       printf( "%s", BLACK );
-       exit( UNSUCCESSFUL_TAG_EXIT );
+  bool mapped = bytes >= g->map && bytes < g->map + g->size;
+  if ( !mapped && !flushSpans( g ) )
+    return -1;
+  return 0;
+}
+
+/**
+  Writes out every span gathered so far with writev, picking up
+  after any partial write.
+
+  @param g The gathered output.
+  @return True if it was all written.
+*/
+bool flushSpans( Gather *g )
+{
+  struct iovec *iov = g->spans;
+  int count = g->count;
+
+  g->count = 0;
+  while ( count > 0 ) {
+    ssize_t n = writev( STDOUT_FILENO, iov, count );
+    if ( n < 0 )
+      return false;
+
+    while ( count > 0 && ( size_t ) n >= iov->iov_len ) {
+      n -= iov->iov_len;
+      iov++;
+      count--;
     }
+    if ( count > 0 ) {
+      iov->iov_base = ( char * ) iov->iov_base + n;
+      iov->iov_len -= n;
+    }
+  }
+
+  return true;
+}
+
+/**
+  Collects a chunk's output, growing its buffer as needed.
+
+  @param ctx The chunk.
+  @param bytes The bytes to collect.
+  @param len The number of bytes.
+  @return Zero, or -1 if there's no memory for them.
+*/
+static int collect( void *ctx, char const *bytes, size_t len )
+{
+  Chunk *c = ( Chunk * ) ctx;
+  if ( c->coloredLen + len > c->coloredCap ) {
+    size_t cap = c->coloredCap * 2;
+    if ( cap < c->coloredLen + len )
+      cap = c->coloredLen + len;
+    char *colored = ( char * ) realloc( c->colored, cap );
+    if ( colored == NULL )
+      return -1;
+    c->colored = colored;
+    c->coloredCap = cap;
+  }
+
+  memcpy( c->colored + c->coloredLen, bytes, len );
+  c->coloredLen += len;
+  return 0;
+}
+
+/**
+  Finds where each chunk would end up from every state it could
+  start in.  This is the speculative pass, one thread per chunk.
+  The lex from the first state leaves a mark at every checkpoint,
+  and the rest stop as soon as they reach one in the same state,
+  since from there they'd go the same way.  That's usually inside
+  the first tag.  The first chunk of a round already knows its
+  start, so it's only lexed from that.
+
+  @param arg The chunk.
+  @return NULL
+*/
+static void *lexChunk( void *arg )
+{
+  Chunk *c = ( Chunk * ) arg;
+  char const *end = c->bytes + c->len;
 
-    putchar( c );
+  HighlightState first = c->known ? c->start : HIGHLIGHT_TEXT;
+  HighlightState state = first;
+  int count = 0;
+  for ( char const *pos = c->bytes; pos < end; pos += CHECKPOINT ) {
+    char const *stop = end - pos > CHECKPOINT ? pos + CHECKPOINT : end;
+    state = lexBlock( state, pos, stop, c->limit, c->sink.entities );
+    c->marks[ count++ ] = state;
   }
+  c->ends[ first ] = state;
 
-  // Needs to mannually place another '>'.
-  putchar( '>' );
+  for ( int s = 0; !c->known && s < HIGHLIGHT_STATES; s++ ) {
+    if ( s == first )
+      continue;
 
-  // Changes color back to black.
-  printf( "%s", BLACK );
+    state = s;
+    int mark = 0;
+    for ( char const *pos = c->bytes; pos < end; pos += CHECKPOINT ) {
+      char const *stop = end - pos > CHECKPOINT ? pos + CHECKPOINT : end;
+      state = lexBlock( state, pos, stop, c->limit, c->sink.entities );
+      if ( state == c->marks[ mark++ ] ) {
+        state = c->ends[ first ];
+        break;
+      }
+    }
+    c->ends[ s ] = state;
+  }
+
+  return NULL;
+}
+
+/**
+  Colors a chunk from the state it really starts in, collecting
+  the output to be written once the chunks before it are.
+
+  @param arg The chunk.
+  @return NULL
+*/
+static void *colorChunk( void *arg )
+{
+  Chunk *c = ( Chunk * ) arg;
+  c->coloredLen = 0;
+  c->end = colorBlock( c->start, c->bytes, c->bytes + c->len, c->limit, &c->sink );
+  flushSink( &c->sink );
+  return NULL;
+}
+
+/**
+  Runs a pass over the chunks, one thread each.  If a thread can't
+  be started, its chunk is done on this one instead.
+
+  @param chunks The chunks.
+  @param count The number of chunks.
+  @param pass What to do to each chunk.
+*/
+static void runPass( Chunk *chunks, int count, void *( *pass )( void * ) )
+{
+  pthread_t ids[ MAX_THREADS ];
+  bool started[ MAX_THREADS ];
+
+  if ( count < 1 )
+    return;
+
+  for ( int i = 1; i < count; i++ )
+    started[ i ] = pthread_create( &ids[ i ], NULL, pass, &chunks[ i ] ) == 0;
+  pass( &chunks[ 0 ] );
+
+  for ( int i = 1; i < count; i++ ) {
+    if ( started[ i ] )
+      pthread_join( ids[ i ], NULL );
+    else
+      pass( &chunks[ i ] );
+  }
 }
 
 /**
-  Colors entities blue.
+  Colors the input on several threads, a chunk each, and writes the
+  chunks out in order.  Input that isn't mapped is read a round of
+  chunks at a time, holding the last few bytes of each round back
+  for the next so the scanner can look ahead past any chunk.
+
+  @param map The mapped input, or NULL to read standard input.
+  @param size The size of the mapped input.
+  @param threads The number of threads to use.
+  @param style The style of output.
+  @param entities What to do with entities.
+  @return The result of highlighting, as from finishHighlighter().
 */
-void showEntity()
+int colorParallel( char const *map, size_t size, int threads, int style, int entities )
 {
-  // The current character.
-  int c;
+  size_t most = ( size_t ) threads * CHUNK;
+  Chunk *chunks = ( Chunk * ) calloc( threads, sizeof( Chunk ) );
+  char *round = NULL;
+  if ( map == NULL )
+    round = ( char * ) malloc( most );
+  if ( chunks == NULL || ( map == NULL && round == NULL ) ) {
+    free( chunks );
+    free( round );
+    return HIGHLIGHT_WRITE_FAILED;
+  }
+
+  bool ok = true;
+  for ( int i = 0; i < threads; i++ ) {
+    chunks[ i ].marks = ( HighlightState * ) malloc( CHUNK / CHECKPOINT + 1 );
+    chunks[ i ].coloredCap = CHUNK + CHUNK / 4;
+    chunks[ i ].colored = ( char * ) malloc( chunks[ i ].coloredCap );
+    initSink( &chunks[ i ].sink, collect, &chunks[ i ] );
+    chunks[ i ].sink.style = style;
+    chunks[ i ].sink.entities = entities;
+    ok = ok && chunks[ i ].marks && chunks[ i ].colored;
+  }
 
-  // Starts the blue text.
-  printf( "%s", BLUE );
+  HighlightState state = HIGHLIGHT_TEXT;
+  size_t done = 0;
+  size_t kept = 0;
+  bool more = true;
+  while ( ok && more ) {
+    // Gets the input for this round.
+    char const *bytes = round;
+    char const *limit = NULL;
+    size_t len = 0;
+    if ( map != NULL ) {
+      bytes = map + done;
+      limit = map + size;
+      len = size - done < most ? size - done : most;
+      done += len;
+      more = done < size;
+    } else {
+      ssize_t n = 0;
+      len = kept;
+      while ( len < most && ( n = read( STDIN_FILENO, round + len, most - len ) ) > 0 )
+        len += n;
+      limit = round + len;
+      more = n > 0;
+      kept = more ? KEEP : 0;
+      len -= kept;
+    }
 
-  // Need to manually place another '&'.
-  putchar( '&' );
+    // Splits it evenly, leaving no chunk empty.
+    size_t share = ( len + threads - 1 ) / threads;
+    int count = 0;
+    for ( size_t pos = 0; pos < len; pos += share ) {
+      chunks[ count ].bytes = bytes + pos;
+      chunks[ count ].len = len - pos < share ? len - pos : share;
+      chunks[ count ].limit = limit;
+      count++;
+    }
 
-  // Parses through the rest of the tag until ';'
-  while ( ( c = getchar() ) != ';' ) {
+    if ( count > 0 ) {
+      // Lexes every chunk from every state, then stitches them together.
+      // Where the last one ends comes out of coloring it.
+      chunks[ 0 ].start = state;
+      chunks[ 0 ].known = true;
+      runPass( chunks, count - 1, lexChunk );
+      for ( int i = 1; i < count; i++ )
+        chunks[ i ].start = chunks[ i - 1 ].ends[ chunks[ i - 1 ].start ];
 
-    // If the EOF is reached before the end of the entity, error is reported.
-    if ( c == -1 ) {
-       printf( "%s", BLACK );
-       exit( UNSUCCESSFUL_ENTITY_EXIT );
+      runPass( chunks, count, colorChunk );
+      state = chunks[ count - 1 ].end;
+      for ( int i = 0; ok && i < count; i++ )
+        ok = !chunks[ i ].sink.failed &&
+             writeAll( NULL, chunks[ i ].colored, chunks[ i ].coloredLen ) == 0;
     }
 
-    putchar( c );
+    if ( map == NULL )
+      memmove( round, round + len, kept );
   }
 
-  // Needs to mannually place another ';'.
-  putchar( ';' );
+  for ( int i = 0; i < threads; i++ ) {
+    free( chunks[ i ].marks );
+    free( chunks[ i ].colored );
+  }
+  free( chunks );
+  free( round );
+  if ( !ok )
+    return HIGHLIGHT_WRITE_FAILED;
 
-  // Changes color back to black.
-  printf( "%s", BLACK );
+  // The end goes through one last sink, to reset the color if needed.
+  static HighlightSink last;
+  initSink( &last, writeAll, NULL );
+  last.style = style;
+  int result = endColor( state, &last );
+  return flushSink( &last ) ? result : HIGHLIGHT_WRITE_FAILED;
 }
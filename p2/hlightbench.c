@@ -0,0 +1,295 @@
+/**
+  @file hlightbench.c
+  @file Nicholas Board (ndboard)
+
+  This program benchmarks hlight.  It generates a large document in
+  each of htmlgen's profiles, then times hlight over it in each of
+  its modes: reading a pipe in blocks, mapping a regular file, with
+  several threads, and with the HTML and plain styles.  It reports
+  gigabytes of input per second and how much the output grew.  Any
+  arguments after the size are other hlight programs to time the
+  same way, so an older build can be compared, like
+  ./hlightbench -s 64 ./hlight /tmp/old/hlight.  An older build
+  that doesn't take the flags either fails those modes or, if it
+  ignores its arguments, is timed without them.
+*/
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<stdbool.h>
+#include<time.h>
+#include<unistd.h>
+#include<sys/types.h>
+#include<sys/wait.h>
+
+// Controls the parameters.
+#define PROFILES 3
+#define MODES 5
+#define MAX_FLAGS 3
+#define MAX_ARGS 8
+#define ARG_LENGTH 16
+#define REPEATS 3
+#define DEFAULT_MEGABYTES 64
+#define CHUNK 65536
+#define FAILED_EXIT 1
+
+// Profiles of htmlgen to time.
+static char *const profiles[ PROFILES ] = { "tags", "text", "entities" };
+
+/** A way of running hlight. */
+typedef struct {
+  /** What the mode is called in the report. */
+  char const *name;
+
+  /** Flags for hlight, ending with NULL. */
+  char *flags[ MAX_FLAGS ];
+
+  /** True to feed the input through a pipe instead of the file. */
+  bool piped;
+} Mode;
+
+// The modes timed, in order.
+static Mode const modes[ MODES ] = {
+  { "pipe", { NULL }, true },
+  { "mmap", { NULL }, false },
+  { "-j 4", { "-j", "4", NULL }, false },
+  { "-f html", { "-f", "html", NULL }, false },
+  { "-f plain", { "-f", "plain", NULL }, false }
+};
+
+/** What one run of hlight measured. */
+typedef struct {
+  /** Seconds from start to exit. */
+  double seconds;
+
+  /** Bytes written to standard output. */
+  long long bytes;
+} Run;
+
+/**
+  Gets the current time in seconds.
+
+  @return seconds on a monotonic clock
+*/
+static double now( void )
+{
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+  Generates a document with htmlgen into a temporary file.
+
+  @param profile The profile to generate.
+  @param size The size in megabytes, as an argument.
+  @param bytes Set to the size of the document.
+  @return The file, or NULL if it can't be made.
+*/
+static FILE *makeCorpus( char *profile, char *size, long long *bytes )
+{
+  FILE *fp = tmpfile();
+  if ( fp == NULL )
+    return NULL;
+
+  pid_t pid = fork();
+  if ( pid == 0 ) {
+    dup2( fileno( fp ), STDOUT_FILENO );
+    execl( "./htmlgen", "./htmlgen", profile, size, ( char * ) NULL );
+    _exit( FAILED_EXIT );
+  }
+
+  int status;
+  if ( pid < 0 || waitpid( pid, &status, 0 ) != pid || !WIFEXITED( status ) ||
+       WEXITSTATUS( status ) != 0 ) {
+    fclose( fp );
+    return NULL;
+  }
+
+  *bytes = lseek( fileno( fp ), 0, SEEK_END );
+  return fp;
+}
+
+/**
+  Copies a file into a pipe, in a child process of its own, so
+  hlight reads it the way it would from another program.
+
+  @param fd The file.
+  @param pipeEnds The pipe, the feeder writing to the second end.
+  @return The feeding process, or -1 if it can't be started.
+*/
+static pid_t feed( int fd, int const pipeEnds[ 2 ] )
+{
+  pid_t pid = fork();
+  if ( pid != 0 )
+    return pid;
+
+  // The feeder mustn't be a reader itself, or it would wait forever
+  // on a full pipe if hlight stops reading.
+  close( pipeEnds[ 0 ] );
+  int out = pipeEnds[ 1 ];
+  static char buffer[ CHUNK ];
+  ssize_t len;
+  while ( ( len = read( fd, buffer, CHUNK ) ) > 0 )
+    if ( write( out, buffer, len ) != len )
+      _exit( FAILED_EXIT );
+  _exit( 0 );
+}
+
+/**
+  Stops feeding a pipe that won't be read, closing the read end so
+  the feeder fails its next write, and waits for it.
+
+  @param in The read end of the pipe.
+  @param feeder The feeding process.
+*/
+static void stopFeeder( int in, pid_t feeder )
+{
+  close( in );
+  waitpid( feeder, NULL, 0 );
+}
+
+/**
+  Runs hlight once over a document, counting its output.
+
+  @param args Arguments for hlight, ending with NULL.
+  @param corpus The document.
+  @param piped True to feed the document through a pipe.
+  @param run Filled with the measurements.
+  @return True if hlight ran and exited successfully.
+*/
+static bool runHlight( char *const args[], FILE *corpus, bool piped, Run *run )
+{
+  lseek( fileno( corpus ), 0, SEEK_SET );
+  double start = now();
+
+  // The feeder is started first, so it doesn't hold the output open.
+  int in[ 2 ];
+  pid_t feeder = -1;
+  if ( piped ) {
+    if ( pipe( in ) != 0 )
+      return false;
+    feeder = feed( fileno( corpus ), in );
+    close( in[ 1 ] );
+    if ( feeder < 0 ) {
+      close( in[ 0 ] );
+      return false;
+    }
+  }
+
+  int out[ 2 ];
+  if ( pipe( out ) != 0 ) {
+    if ( piped )
+      stopFeeder( in[ 0 ], feeder );
+    return false;
+  }
+
+  pid_t pid = fork();
+  if ( pid < 0 ) {
+    close( out[ 0 ] );
+    close( out[ 1 ] );
+    if ( piped )
+      stopFeeder( in[ 0 ], feeder );
+    return false;
+  }
+
+  if ( pid == 0 ) {
+    dup2( piped ? in[ 0 ] : fileno( corpus ), STDIN_FILENO );
+    dup2( out[ 1 ], STDOUT_FILENO );
+    close( out[ 0 ] );
+    close( out[ 1 ] );
+    execv( args[ 0 ], args );
+    _exit( FAILED_EXIT );
+  }
+
+  // Drains the output, just counting it.
+  if ( piped )
+    close( in[ 0 ] );
+  close( out[ 1 ] );
+  static char buffer[ CHUNK ];
+  ssize_t len;
+  run->bytes = 0;
+  while ( ( len = read( out[ 0 ], buffer, CHUNK ) ) > 0 )
+    run->bytes += len;
+  close( out[ 0 ] );
+
+  int status;
+  if ( waitpid( pid, &status, 0 ) != pid )
+    return false;
+  run->seconds = now() - start;
+  if ( piped )
+    waitpid( feeder, NULL, 0 );
+
+  return WIFEXITED( status ) && WEXITSTATUS( status ) == 0;
+}
+
+/**
+  Where the program begins.
+
+  @param argc The number of command-line arguments.
+  @param argv The size, and hlight programs to time.
+  @return program exit status
+*/
+int main( int argc, char *argv[] )
+{
+  char size[ ARG_LENGTH ];
+  sprintf( size, "%d", DEFAULT_MEGABYTES );
+  int first = 1;
+  if ( argc > 2 && strcmp( argv[ 1 ], "-s" ) == 0 ) {
+    if ( atoi( argv[ 2 ] ) < 1 || strlen( argv[ 2 ] ) >= ARG_LENGTH ) {
+      fprintf( stderr, "usage: hlightbench [-s <megabytes>] [hlight ...]\n" );
+      return FAILED_EXIT;
+    }
+    strcpy( size, argv[ 2 ] );
+    first = 3;
+  }
+
+  // Times ./hlight unless others are given.
+  char *defaults[] = { "./hlight" };
+  char **programs = first < argc ? argv + first : defaults;
+  int programCount = first < argc ? argc - first : 1;
+
+  printf( "%8s %-16s %-8s %9s %8s %7s\n", "profile", "program", "mode", "seconds", "GB/s",
+          "growth" );
+
+  for ( int p = 0; p < PROFILES; p++ ) {
+    long long bytes;
+    FILE *corpus = makeCorpus( profiles[ p ], size, &bytes );
+    if ( corpus == NULL ) {
+      fprintf( stderr, "Can't generate a %s document with ./htmlgen\n", profiles[ p ] );
+      return FAILED_EXIT;
+    }
+
+    for ( int h = 0; h < programCount; h++ )
+      for ( int m = 0; m < MODES; m++ ) {
+        char *args[ MAX_ARGS ] = { programs[ h ] };
+        for ( int f = 0; modes[ m ].flags[ f ] != NULL; f++ )
+          args[ f + 1 ] = modes[ m ].flags[ f ];
+
+        // Keeps the best of a few runs.
+        Run best = { 0, 0 };
+        bool ok = true;
+        for ( int r = 0; ok && r < REPEATS; r++ ) {
+          Run run;
+          ok = runHlight( args, corpus, modes[ m ].piped, &run );
+          if ( ok && ( r == 0 || run.seconds < best.seconds ) )
+            best = run;
+        }
+
+        if ( ok )
+          printf( "%8s %-16s %-8s %9.3f %8.2f %6.2fx\n", profiles[ p ], programs[ h ],
+                  modes[ m ].name, best.seconds, bytes / best.seconds / 1e9,
+                  ( double ) best.bytes / bytes );
+        else
+          printf( "%8s %-16s %-8s %9s\n", profiles[ p ], programs[ h ], modes[ m ].name,
+                  "failed" );
+        fflush( stdout );
+      }
+
+    fclose( corpus );
+  }
+
+  // Exits the program successfully.
+  return 0;
+}
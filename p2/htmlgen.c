@@ -0,0 +1,250 @@
+/**
+  @file htmlgen.c
+  @file Nicholas Board (ndboard)
+
+  This program writes a large made-up HTML document for timing
+  hlight.  It's built from random but realistic pieces: nested
+  elements with attributes, paragraphs of prose, entities, and now
+  and then a comment, script or style body.  The profile picks the
+  mix, tag-dense markup, text-dense prose, or entity-heavy text,
+  and the same seed always gives the same document.
+*/
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<stdarg.h>
+
+// Define the exit numbers.
+#define USAGE_EXIT 1
+#define OUTPUT_EXIT 1
+
+// Controls the parameters.
+#define PROFILES 3
+#define MAX_MEGABYTES 65536
+#define DEFAULT_SEED 230
+#define MAX_DEPTH 6
+
+/** The mixes of content that can be generated. */
+typedef enum { TAG_DENSE, TEXT_DENSE, ENTITY_HEAVY } Profile;
+
+// Names of the profiles on the command line.
+static char const *const profileNames[ PROFILES ] = { "tags", "text", "entities" };
+
+// Pieces the document is built from.
+#define ELEMENTS 10
+static char const *const elements[ ELEMENTS ] = {
+  "div", "span", "a", "li", "td", "section", "em", "strong", "button", "label"
+};
+#define ATTRIBUTES 8
+static char const *const attributes[ ATTRIBUTES ] = {
+  "class", "id", "href", "title", "data-index", "style", "aria-label", "tabindex"
+};
+#define WORDS 16
+static char const *const words[ WORDS ] = {
+  "the", "quick", "voronoi", "diagram", "shows", "which", "seed", "is", "nearest",
+  "to", "every", "pixel", "on", "a", "large", "canvas"
+};
+#define ENTITIES 10
+static char const *const entities[ ENTITIES ] = {
+  "&amp;", "&lt;", "&gt;", "&quot;", "&nbsp;", "&copy;", "&mdash;", "&#169;", "&#x2014;",
+  "&hellip;"
+};
+
+/** State of the random number generator. */
+static unsigned long long rng;
+
+/** Number of bytes written so far. */
+static long long written;
+
+/**
+  Writes formatted output, counting it.
+
+  @param format The format, as for printf.
+*/
+static void out( char const *format, ... )
+{
+  va_list args;
+  va_start( args, format );
+  int len = vprintf( format, args );
+  va_end( args );
+  if ( len > 0 )
+    written += len;
+}
+
+/**
+  Gets the next random number, from a xorshift generator so the
+  document doesn't depend on the C library.
+
+  @param n One past the largest number wanted.
+  @return A number from 0 to n - 1.
+*/
+static int pick( int n )
+{
+  rng ^= rng << 13;
+  rng ^= rng >> 7;
+  rng ^= rng << 17;
+  return ( int ) ( ( rng >> 33 ) % n );
+}
+
+/**
+  Writes a sentence of prose, with entities and inline elements
+  mixed in as often as the profile calls for.
+
+  @param profile The mix of content.
+*/
+static void sentence( Profile profile )
+{
+  int len = 6 + pick( 14 );
+  for ( int i = 0; i < len; i++ ) {
+    if ( i > 0 )
+      out( " " );
+
+    int roll = pick( 100 );
+    if ( ( profile == ENTITY_HEAVY && roll < 30 ) || roll < 2 )
+      out( "%s", entities[ pick( ENTITIES ) ] );
+    else if ( profile != TEXT_DENSE && roll > 94 )
+      out( "<em>%s</em>", words[ pick( WORDS ) ] );
+    else
+      out( "%s", words[ pick( WORDS ) ] );
+  }
+  out( ". " );
+}
+
+/**
+  Writes an opening tag with a few attributes.
+
+  @param name The name of the element.
+*/
+static void openTag( char const *name )
+{
+  out( "<%s", name );
+  int count = pick( 4 );
+  for ( int i = 0; i < count; i++ ) {
+    char const *attr = attributes[ pick( ATTRIBUTES ) ];
+    switch ( pick( 3 ) ) {
+    case 0:
+      out( " %s=\"%s-%d\"", attr, words[ pick( WORDS ) ], pick( 1000 ) );
+      break;
+    case 1:
+      out( " %s='%s'", attr, words[ pick( WORDS ) ] );
+      break;
+    default:
+      out( " %s=%d", attr, pick( 100 ) );
+    }
+  }
+  if ( pick( 10 ) == 0 )
+    out( " hidden" );
+  out( ">" );
+}
+
+/**
+  Writes an element, and the elements or words nested inside it.
+
+  @param depth How deep the element is nested.
+*/
+static void element( int depth )
+{
+  char const *name = elements[ pick( ELEMENTS ) ];
+  openTag( name );
+
+  int children = pick( 4 );
+  for ( int i = 0; i < children; i++ ) {
+    if ( depth < MAX_DEPTH && pick( 3 ) > 0 )
+      element( depth + 1 );
+    else
+      out( " %s ", words[ pick( WORDS ) ] );
+  }
+
+  out( "</%s>\n", name );
+}
+
+/**
+  Writes a paragraph of a few sentences.
+
+  @param profile The mix of content.
+*/
+static void paragraph( Profile profile )
+{
+  out( "<p>" );
+  int count = 1 + pick( 5 );
+  for ( int i = 0; i < count; i++ )
+    sentence( profile );
+  out( "</p>\n" );
+}
+
+/**
+  Writes one of the rarer pieces: a comment, a script or a style.
+*/
+static void aside( void )
+{
+  switch ( pick( 3 ) ) {
+  case 0:
+    out( "<!-- %s <%s> -- %s -->\n", words[ pick( WORDS ) ], elements[ pick( ELEMENTS ) ],
+         words[ pick( WORDS ) ] );
+    break;
+  case 1:
+    out( "<script type=\"text/javascript\">\n  if ( a < %d && b > c ) "
+            "el.innerHTML = \"<b>&amp;</b>\";\n</script>\n", pick( 100 ) );
+    break;
+  default:
+    out( "<style>\n  %s > %s { margin: %dpx; }\n</style>\n", elements[ pick( ELEMENTS ) ],
+         elements[ pick( ELEMENTS ) ], pick( 20 ) );
+  }
+}
+
+/**
+  Prints how to run the program.
+
+  @return The exit status for bad arguments.
+*/
+static int usage( void )
+{
+  fprintf( stderr, "usage: htmlgen tags|text|entities <megabytes> [seed]\n" );
+  return USAGE_EXIT;
+}
+
+/**
+  Where the program begins.
+
+  @param argc The number of command-line arguments.
+  @param argv The profile, the size in megabytes and maybe a seed.
+  @return program exit status
+*/
+int main( int argc, char *argv[] )
+{
+  if ( argc != 3 && argc != 4 )
+    return usage();
+
+  int profile = 0;
+  while ( profile < PROFILES && strcmp( argv[ 1 ], profileNames[ profile ] ) != 0 )
+    profile++;
+
+  char *end;
+  long megabytes = strtol( argv[ 2 ], &end, 10 );
+  if ( profile == PROFILES || end == argv[ 2 ] || *end != '\0' || megabytes < 1 ||
+       megabytes > MAX_MEGABYTES )
+    return usage();
+
+  rng = argc == 4 ? strtoull( argv[ 3 ], NULL, 10 ) : DEFAULT_SEED;
+  rng = rng * 2654435761u + 1;
+
+  // Writes whole top-level pieces until the document is big enough.
+  long long size = megabytes * 1024LL * 1024;
+  out( "<!DOCTYPE html>\n<html lang=\"en\">\n<body>\n" );
+  while ( written < size && !ferror( stdout ) ) {
+    if ( pick( 20 ) == 0 )
+      aside();
+    else if ( profile == TAG_DENSE )
+      element( 0 );
+    else
+      paragraph( profile );
+  }
+  out( "</body>\n</html>\n" );
+
+  if ( fflush( stdout ) != 0 || ferror( stdout ) )
+    return OUTPUT_EXIT;
+
+  // Exits the program successfully.
+  return 0;
+}
@@ -0,0 +1,228 @@
+/**
+    @file kdtree.c
+    @author Nicholas Board (ndboard)
+
+    Builds a 2-d tree over the seeds and answers nearest seed
+    queries in about O(log n) time per pixel.
+*/
+
+#include<stdlib.h>
+#include"kdtree.h"
+
+/**
+    Gets the coordinate a node splits on.
+
+    @param s The seed at the node.
+    @param depth The depth of the node, even depths split on x.
+    @return The coordinate along the splitting axis.
+*/
+static double axisOf( Seed const *s, int depth )
+{
+  return depth % 2 == 0 ? s->x : s->y;
+}
+
+/**
+    Rearranges order[ lo .. hi ) so the element at k is where it would
+    be if the range were sorted along the axis, with nothing larger
+    before it and nothing smaller after it.
+
+    @param list The seeds.
+    @param order The seed indices to rearrange.
+    @param lo The start of the range.
+    @param hi One past the end of the range.
+    @param k The position to select.
+    @param depth The depth, which picks the axis.
+*/
+static void selectMedian( Seed const *list, int *order, int lo, int hi, int k, int depth )
+{
+  while ( hi - lo > 1 ) {
+    double pivot = axisOf( &list[ order[ lo + ( hi - lo ) / 2 ] ], depth );
+
+    // Hoare style partition around the pivot value.
+    int i = lo;
+    int j = hi - 1;
+    while ( i <= j ) {
+      while ( axisOf( &list[ order[ i ] ], depth ) < pivot )
+        i++;
+      while ( axisOf( &list[ order[ j ] ], depth ) > pivot )
+        j--;
+      if ( i <= j ) {
+        int tmp = order[ i ];
+        order[ i ] = order[ j ];
+        order[ j ] = tmp;
+        i++;
+        j--;
+      }
+    }
+
+    // Keep going in whichever part holds position k.
+    if ( k <= j )
+      hi = j + 1;
+    else if ( k >= i )
+      lo = i;
+    else
+      return;
+  }
+}
+
+/**
+    Arranges order[ lo .. hi ) into a subtree.
+
+    @param list The seeds.
+    @param order The seed indices to arrange.
+    @param lo The start of the range.
+    @param hi One past the end of the range.
+    @param depth The depth of the subtree's root.
+*/
+static void arrange( Seed const *list, int *order, int lo, int hi, int depth )
+{
+  if ( hi - lo <= 1 )
+    return;
+
+  int mid = lo + ( hi - lo ) / 2;
+  selectMedian( list, order, lo, hi, mid, depth );
+  arrange( list, order, lo, mid, depth + 1 );
+  arrange( list, order, mid + 1, hi, depth + 1 );
+}
+
+KDTree *buildTree( Seed const *list, int count )
+{
+  KDTree *t = ( KDTree * ) malloc( sizeof( KDTree ) );
+  if ( t == NULL )
+    return NULL;
+
+  t->count = count;
+  t->list = list;
+  t->order = ( int * ) malloc( ( count > 0 ? count : 1 ) * sizeof( int ) );
+  if ( t->order == NULL ) {
+    free( t );
+    return NULL;
+  }
+
+  for ( int i = 0; i < count; i++ )
+    t->order[ i ] = i;
+
+  arrange( list, t->order, 0, count, 0 );
+  return t;
+}
+
+void freeTree( KDTree *t )
+{
+  free( t->order );
+  free( t );
+}
+
+/**
+    Searches a subtree for the owner of a pixel.  The far side of a
+    split is only visited when it could hold a seed at least as close
+    as the best so far, since ties still matter for choosing the owner.
+
+    @param t The tree.
+    @param lo The start of the subtree's range.
+    @param hi One past the end of the subtree's range.
+    @param depth The depth of the subtree's root.
+    @param col The column of the pixel.
+    @param row The row of the pixel.
+    @param skip Seeds to leave out, or NULL.
+    @param best The best candidate so far.
+*/
+static void search( KDTree const *t, int lo, int hi, int depth,
+                    int col, int row, bool const *skip, Nearest *best )
+{
+  while ( lo < hi ) {
+    int mid = lo + ( hi - lo ) / 2;
+    Seed const *s = &t->list[ t->order[ mid ] ];
+    if ( skip == NULL || !skip[ t->order[ mid ] ] )
+      considerSeed( best, t->list, t->order[ mid ], col, row );
+
+    double diff = depth % 2 == 0 ? col - s->x : row - s->y;
+
+    // Descend the near side, and loop on the far side if it's in reach.
+    if ( diff < 0 ) {
+      search( t, lo, mid, depth + 1, col, row, skip, best );
+      lo = mid + 1;
+    } else {
+      search( t, mid + 1, hi, depth + 1, col, row, skip, best );
+      hi = mid;
+    }
+
+    if ( diff * diff > best->dist )
+      return;
+    depth++;
+  }
+}
+
+int nearestInTree( KDTree const *t, int col, int row, int hint )
+{
+  Nearest best;
+  initNearest( &best );
+
+  // Starting from a nearby seed lets most of the tree be pruned.
+  if ( hint != NO_OWNER )
+    considerSeed( &best, t->list, hint, col, row );
+
+  search( t, 0, t->count, 0, col, row, NULL, &best );
+  return best.owner;
+}
+
+/**
+    Searches a subtree for the seed closest to a point, pruning like
+    search().
+
+    @param t The tree.
+    @param lo The start of the subtree's range.
+    @param hi One past the end of the subtree's range.
+    @param depth The depth of the subtree's root.
+    @param x The x coordinate of the point.
+    @param y The y coordinate of the point.
+    @param best The best candidate so far.
+*/
+static void searchPoint( KDTree const *t, int lo, int hi, int depth,
+                         double x, double y, Nearest *best )
+{
+  while ( lo < hi ) {
+    int mid = lo + ( hi - lo ) / 2;
+    int idx = t->order[ mid ];
+    double dx = x - t->list[ idx ].x;
+    double dy = y - t->list[ idx ].y;
+    double d = dx * dx + dy * dy;
+    if ( d < best->dist || ( d == best->dist && idx < best->owner ) ) {
+      best->dist = d;
+      best->owner = idx;
+    }
+
+    double diff = depth % 2 == 0 ? dx : dy;
+    if ( diff < 0 ) {
+      searchPoint( t, lo, mid, depth + 1, x, y, best );
+      lo = mid + 1;
+    } else {
+      searchPoint( t, mid + 1, hi, depth + 1, x, y, best );
+      hi = mid;
+    }
+
+    if ( diff * diff > best->dist )
+      return;
+    depth++;
+  }
+}
+
+int nearestPoint( KDTree const *t, double x, double y, int hint )
+{
+  Nearest best;
+  initNearest( &best );
+
+  if ( hint != NO_OWNER ) {
+    double dx = x - t->list[ hint ].x;
+    double dy = y - t->list[ hint ].y;
+    best.dist = dx * dx + dy * dy;
+    best.owner = hint;
+  }
+
+  searchPoint( t, 0, t->count, 0, x, y, &best );
+  return best.owner;
+}
+
+void searchTree( KDTree const *t, int col, int row, bool const *skip, Nearest *best )
+{
+  search( t, 0, t->count, 0, col, row, skip, best );
+}
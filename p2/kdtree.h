@@ -0,0 +1,82 @@
+/**
+    @file kdtree.h
+    @author Nicholas Board (ndboard)
+
+    Contains the k-d tree used to find the seed that owns a pixel
+    without comparing against every seed.
+*/
+
+#ifndef _KDTREE_H_
+#define _KDTREE_H_
+
+#include "seed.h"
+
+/** A 2-d tree over a list of seeds, stored implicitly in an array. */
+typedef struct {
+  /** Number of seeds in the tree. */
+  int count;
+
+  /** The seeds, in the order they were given. */
+  Seed const *list;
+
+  /** Seed indices in tree order.  The node for a range is its middle
+      element, with the smaller half before it and the larger after. */
+  int *order;
+} KDTree;
+
+/**
+    Builds a k-d tree over the given seeds.  The seed list is not
+    copied, so it has to outlive the tree.
+
+    @param list The seeds to index.
+    @param count The number of seeds.
+    @return The new tree, or NULL if it can't be allocated.
+*/
+KDTree *buildTree( Seed const *list, int count );
+
+/**
+    Frees a tree's allocated space.
+
+    @param t The tree to free.
+*/
+void freeTree( KDTree *t );
+
+/**
+    Finds the seed that owns the given pixel.
+
+    @param t The tree to search.
+    @param col The column of the pixel.
+    @param row The row of the pixel.
+    @param hint A seed likely to be close, such as the owner of the
+                previous pixel, or NO_OWNER.
+    @return The index of the owning seed, or NO_OWNER for a white pixel.
+*/
+int nearestInTree( KDTree const *t, int col, int row, int hint );
+
+/**
+    Finds the seed closest to a point anywhere in the plane, such as
+    a sample inside a pixel.  Ties go to the lowest index, and no
+    seed is skipped for rounding to the point.
+
+    @param t The tree to search.
+    @param x The x coordinate of the point.
+    @param y The y coordinate of the point.
+    @param hint A seed likely to be close, or NO_OWNER.
+    @return The index of the closest seed.
+*/
+int nearestPoint( KDTree const *t, double x, double y, int hint );
+
+/**
+    Offers every seed in the tree to a search in progress, except the
+    ones marked to skip.  This lets a caller mix in seeds the tree
+    doesn't know about, or has stale positions for.
+
+    @param t The tree to search.
+    @param col The column of the pixel.
+    @param row The row of the pixel.
+    @param skip Seeds to leave out, indexed like the seed list, or NULL.
+    @param best The search state to update.
+*/
+void searchTree( KDTree const *t, int col, int row, bool const *skip, Nearest *best );
+
+#endif
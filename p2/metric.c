@@ -0,0 +1,205 @@
+/**
+    @file metric.c
+    @author Nicholas Board (ndboard)
+
+    Labels rows under the alternate metrics.  Each metric gets its
+    own copy of the tree search and row loop, stamped out by a macro
+    with the distance and pruning bound written inline, so choosing
+    the metric costs one pointer call per row rather than per pixel.
+*/
+
+#include<stdlib.h>
+#include<string.h>
+#include"metric.h"
+
+/** Names of the metrics, indexed by metric. */
+static char const *const names[] = {
+  "euclidean", "manhattan", "chebyshev", "additive", "multiplicative", "power"
+};
+
+/**
+    Stamps out the search and row labeler for a metric.  DIST is the
+    distance of a seed given dx, dy and its weight w, and BOUND is a
+    lower bound on the distance of every seed past a split that is
+    diff away along the split's axis, given the heaviest weight h.
+    Bounds are computed the same way as the distances they bound, so
+    rounding can't make a bound exceed a distance, and ties are kept.
+    Metrics that ignore weights leave w and h unused.  Besides the row
+    labeler, a point query is stamped out for samples inside pixels,
+    which skips no seeds and gives ties to the lowest index.
+
+    @param NAME Suffix for the generated functions.
+    @param DIST Expression for the distance.
+    @param BOUND Expression for the lower bound.
+*/
+#define DEFINE_METRIC( NAME, DIST, BOUND )                                     \
+  static void search##NAME( Metric const *m, int lo, int hi, int depth,        \
+                            int col, int row, Nearest *best )                  \
+  {                                                                            \
+    KDTree const *t = m->tree;                                                 \
+    double h = m->heaviest;                                                    \
+    ( void ) h;                                                                \
+    while ( lo < hi ) {                                                        \
+      int mid = lo + ( hi - lo ) / 2;                                          \
+      int idx = t->order[ mid ];                                               \
+      Seed const *s = &t->list[ idx ];                                         \
+      double dx = col - s->x;                                                  \
+      double dy = row - s->y;                                                  \
+      double w = s->weight;                                                    \
+      ( void ) w;                                                              \
+      considerDistance( best, t->list, idx, ( DIST ), col, row );              \
+                                                                               \
+      double diff = depth % 2 == 0 ? dx : dy;                                  \
+      if ( diff < 0 ) {                                                        \
+        search##NAME( m, lo, mid, depth + 1, col, row, best );                 \
+        lo = mid + 1;                                                          \
+      } else {                                                                 \
+        search##NAME( m, mid + 1, hi, depth + 1, col, row, best );             \
+        hi = mid;                                                              \
+      }                                                                        \
+                                                                               \
+      if ( ( BOUND ) > best->dist )                                            \
+        return;                                                                \
+      depth++;                                                                 \
+    }                                                                          \
+  }                                                                            \
+                                                                               \
+  static void label##NAME( Metric const *m, int row, int width, int *owners )  \
+  {                                                                            \
+    Seed const *list = m->tree->list;                                          \
+    int owner = NO_OWNER;                                                      \
+    for ( int j = 0; j < width; j++ ) {                                        \
+      Nearest best;                                                            \
+      initNearest( &best );                                                    \
+      if ( owner != NO_OWNER ) {                                               \
+        double dx = j - list[ owner ].x;                                       \
+        double dy = row - list[ owner ].y;                                     \
+        double w = list[ owner ].weight;                                       \
+        ( void ) w;                                                            \
+        considerDistance( &best, list, owner, ( DIST ), j, row );              \
+      }                                                                        \
+      search##NAME( m, 0, m->tree->count, 0, j, row, &best );                  \
+      owner = owners[ j ] = best.owner;                                        \
+    }                                                                          \
+  }                                                                            \
+                                                                               \
+  static void seek##NAME( Metric const *m, int lo, int hi, int depth,          \
+                          double x, double y, Nearest *best )                  \
+  {                                                                            \
+    KDTree const *t = m->tree;                                                 \
+    double h = m->heaviest;                                                    \
+    ( void ) h;                                                                \
+    while ( lo < hi ) {                                                        \
+      int mid = lo + ( hi - lo ) / 2;                                          \
+      int idx = t->order[ mid ];                                               \
+      Seed const *s = &t->list[ idx ];                                         \
+      double dx = x - s->x;                                                    \
+      double dy = y - s->y;                                                    \
+      double w = s->weight;                                                    \
+      ( void ) w;                                                              \
+      double d = ( DIST );                                                     \
+      if ( d < best->dist || ( d == best->dist && idx < best->owner ) ) {      \
+        best->dist = d;                                                        \
+        best->owner = idx;                                                     \
+      }                                                                        \
+                                                                               \
+      double diff = depth % 2 == 0 ? dx : dy;                                  \
+      if ( diff < 0 ) {                                                        \
+        seek##NAME( m, lo, mid, depth + 1, x, y, best );                       \
+        lo = mid + 1;                                                          \
+      } else {                                                                 \
+        seek##NAME( m, mid + 1, hi, depth + 1, x, y, best );                   \
+        hi = mid;                                                              \
+      }                                                                        \
+                                                                               \
+      if ( ( BOUND ) > best->dist )                                            \
+        return;                                                                \
+      depth++;                                                                 \
+    }                                                                          \
+  }                                                                            \
+                                                                               \
+  static int nearest##NAME( Metric const *m, double x, double y, int hint )    \
+  {                                                                            \
+    Nearest best;                                                              \
+    initNearest( &best );                                                      \
+    if ( hint != NO_OWNER ) {                                                  \
+      Seed const *s = &m->tree->list[ hint ];                                  \
+      double dx = x - s->x;                                                    \
+      double dy = y - s->y;                                                    \
+      double w = s->weight;                                                    \
+      ( void ) w;                                                              \
+      best.dist = ( DIST );                                                    \
+      best.owner = hint;                                                       \
+    }                                                                          \
+    seek##NAME( m, 0, m->tree->count, 0, x, y, &best );                        \
+    return best.owner;                                                         \
+  }
+
+DEFINE_METRIC( Manhattan, fabs( dx ) + fabs( dy ), fabs( diff ) )
+DEFINE_METRIC( Chebyshev, fmax( fabs( dx ), fabs( dy ) ), fabs( diff ) )
+DEFINE_METRIC( Additive, sqrt( dx * dx + dy * dy ) - w, sqrt( diff * diff ) - h )
+DEFINE_METRIC( Multiplicative, sqrt( dx * dx + dy * dy ) / w, sqrt( diff * diff ) / h )
+DEFINE_METRIC( Power, dx * dx + dy * dy - w, diff * diff - h )
+
+int metricNamed( char const *name )
+{
+  for ( int i = 0; i < ( int ) ( sizeof( names ) / sizeof( names[ 0 ] ) ); i++ )
+    if ( strcmp( name, names[ i ] ) == 0 )
+      return i;
+  return -1;
+}
+
+bool isWeighted( int kind )
+{
+  return kind == ADDITIVE || kind == MULTIPLICATIVE || kind == POWER;
+}
+
+bool validWeights( int kind, Seed const *list, int count )
+{
+  for ( int i = 0; i < count; i++ )
+    if ( !isfinite( list[ i ].weight ) || ( kind == MULTIPLICATIVE && list[ i ].weight <= 0 ) )
+      return false;
+  return true;
+}
+
+Metric *buildMetric( KDTree const *tree, int kind )
+{
+  Metric *m = ( Metric * ) malloc( sizeof( Metric ) );
+  if ( m == NULL )
+    return NULL;
+
+  m->tree = tree;
+  m->heaviest = -INFINITY;
+  for ( int i = 0; i < tree->count; i++ )
+    m->heaviest = fmax( m->heaviest, tree->list[ i ].weight );
+
+  switch ( kind ) {
+    case MANHATTAN:
+      m->labelRow = labelManhattan;
+      m->nearestAt = nearestManhattan;
+      break;
+    case CHEBYSHEV:
+      m->labelRow = labelChebyshev;
+      m->nearestAt = nearestChebyshev;
+      break;
+    case ADDITIVE:
+      m->labelRow = labelAdditive;
+      m->nearestAt = nearestAdditive;
+      break;
+    case MULTIPLICATIVE:
+      m->labelRow = labelMultiplicative;
+      m->nearestAt = nearestMultiplicative;
+      break;
+    default:
+      m->labelRow = labelPower;
+      m->nearestAt = nearestPower;
+      break;
+  }
+
+  return m;
+}
+
+void freeMetric( Metric *m )
+{
+  free( m );
+}
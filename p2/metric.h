@@ -0,0 +1,96 @@
+/**
+    @file metric.h
+    @author Nicholas Board (ndboard)
+
+    Contains the labelers for diagrams under metrics other than the
+    plain Euclidean one: Manhattan and Chebyshev distance, seeds
+    weighted additively or multiplicatively, and power diagrams.
+*/
+
+#ifndef _METRIC_H_
+#define _METRIC_H_
+
+#include "kdtree.h"
+
+/** Metrics a diagram can be drawn with.  Euclidean uses the usual engines. */
+#define EUCLIDEAN 0
+#define MANHATTAN 1
+#define CHEBYSHEV 2
+#define ADDITIVE 3
+#define MULTIPLICATIVE 4
+#define POWER 5
+
+/** A metric chosen for a set of seeds. */
+typedef struct MetricTag {
+  /** Tree over the seeds. */
+  KDTree const *tree;
+
+  /** The largest weight of any seed. */
+  double heaviest;
+
+  /** Labeler for a row, specialized for the metric. */
+  void ( *labelRow )( struct MetricTag const *m, int row, int width, int *owners );
+
+  /** Finds the seed closest to any point, specialized for the metric. */
+  int ( *nearestAt )( struct MetricTag const *m, double x, double y, int hint );
+} Metric;
+
+/**
+    Looks up a metric by its name, like "manhattan" or "power".
+
+    @param name The name of the metric.
+    @return The metric, or -1 if there's none by that name.
+*/
+int metricNamed( char const *name );
+
+/**
+    Tells if seeds need weights under a metric.
+
+    @param kind The metric.
+    @return True if every seed is given a weight.
+*/
+bool isWeighted( int kind );
+
+/**
+    Tells if the weights of seeds are valid for a metric.
+    Multiplicative weights have to be positive.
+
+    @param kind The metric.
+    @param list The seeds.
+    @param count The number of seeds.
+    @return True if every weight can be used.
+*/
+bool validWeights( int kind, Seed const *list, int count );
+
+/**
+    Chooses the labeler for a metric other than EUCLIDEAN.  The
+    tree is searched with a bound made for the metric, so rows are
+    labeled in about O( log n ) time per pixel.
+
+    @param tree Tree over the seeds, which has to outlive the metric.
+    @param kind The metric.
+    @return The new metric, or NULL if it can't be allocated.
+*/
+Metric *buildMetric( KDTree const *tree, int kind );
+
+/**
+    Frees a metric's allocated space.
+
+    @param m The metric to free.
+*/
+void freeMetric( Metric *m );
+
+/**
+    Labels a row of pixels with their owners under the metric.
+
+    @param m The metric.
+    @param row The row to label.
+    @param width The width of the row.
+    @param owners Filled with the owner of each pixel.
+*/
+static inline void metricRow( Metric const *m, int row, int width, int *owners )
+{
+  m->labelRow( m, row, width, owners );
+}
+
+#endif
@@ -0,0 +1,288 @@
+/**
+    @file ppm.c
+    @author Nicholas Board (ndboard)
+
+    Paints rows of owners as pixels and writes the image out,
+    one buffered write per row, or into a mapped file.  Builds the
+    palettes the pixels are painted from.
+*/
+
+#include<stdlib.h>
+#include<string.h>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/mman.h>
+#include"ppm.h"
+
+/** Longest header we write, "P6\n32768 32768\n255\n" and more. */
+#define HEADER_LIMIT 64
+
+/** Number of colors cycled through by the classic palette. */
+#define PALETTE_SIZE 12
+
+/** The golden ratio's fractional part, which spaces out generated hues. */
+#define HUE_STEP 0.618033988749895
+
+/** Saturation and value of generated colors. */
+#define SATURATION 0.7
+#define VALUE 0.95
+
+/** Steps of brightness when shading, as a fixed point fraction. */
+#define SHADE_LEVELS 256
+
+/** Fraction of the brightness left at the falloff distance and beyond. */
+#define DARKEST 0.25
+
+/** Colors cycled through by the seeds, in input order. */
+static unsigned char const classic[ PALETTE_SIZE ][ BINARY_PIXEL ] = {
+  { 255, 0, 0 }, { 0, 255, 0 }, { 0, 0, 255 },
+  { 255, 255, 0 }, { 0, 255, 255 }, { 255, 0, 255 },
+  { 255, 128, 0 }, { 128, 0, 255 }, { 0, 128, 64 },
+  { 128, 64, 0 }, { 0, 64, 128 }, { 128, 128, 128 }
+};
+
+/** Color for pixels that are owned by no seed. */
+static unsigned char const white[ BINARY_PIXEL ] = { 255, 255, 255 };
+
+/** Every channel value written out as text, with a space after. */
+static char decimal[ SHADE_LEVELS ][ TEXT_PIXEL / BINARY_PIXEL + 1 ];
+
+/**
+    Converts a hue to a color at the generated saturation and value.
+
+    @param hue The hue, from 0 up to 1.
+    @param c Filled with the color.
+*/
+static void hueColor( double hue, unsigned char *c )
+{
+  double h = hue * 6;
+  int sector = ( int ) h % 6;
+  double f = h - floor( h );
+  double v = VALUE * 255;
+  double p = v * ( 1 - SATURATION );
+  double q = v * ( 1 - SATURATION * f );
+  double t = v * ( 1 - SATURATION * ( 1 - f ) );
+  double rgb[ 6 ][ BINARY_PIXEL ] = {
+    { v, t, p }, { q, v, p }, { p, v, t }, { p, q, v }, { t, p, v }, { v, p, q }
+  };
+
+  for ( int k = 0; k < BINARY_PIXEL; k++ )
+    c[ k ] = ( unsigned char ) round( rgb[ sector ][ k ] );
+}
+
+/**
+    Writes a color out as text.
+
+    @param c The color.
+    @param dest Where the TEXT_PIXEL bytes go.
+*/
+static void colorText( unsigned char const *c, char *dest )
+{
+  for ( int k = 0; k < BINARY_PIXEL; k++ )
+    memcpy( dest + k * 4, decimal[ c[ k ] ], 4 );
+}
+
+Palette *buildPalette( int count, bool generated )
+{
+  Palette *p = ( Palette * ) malloc( sizeof( Palette ) );
+  if ( p == NULL )
+    return NULL;
+
+  p->count = count;
+  p->shade = NULL;
+  p->falloff = 1;
+  p->rgb = ( unsigned char * ) malloc( ( count + 1L ) * BINARY_PIXEL );
+  p->text = ( char * ) malloc( ( count + 1L ) * TEXT_PIXEL );
+  if ( p->rgb == NULL || p->text == NULL ) {
+    freePalette( p );
+    return NULL;
+  }
+
+  for ( int i = 0; i < SHADE_LEVELS; i++ )
+    sprintf( decimal[ i ], "%3d ", i );
+
+  // Slot 0 is white, so an owner's color is at owner + 1.
+  memcpy( p->rgb, white, BINARY_PIXEL );
+  for ( int i = 0; i < count; i++ ) {
+    unsigned char *c = p->rgb + ( i + 1L ) * BINARY_PIXEL;
+    if ( generated )
+      hueColor( fmod( i * HUE_STEP, 1 ), c );
+    else
+      memcpy( c, classic[ i % PALETTE_SIZE ], BINARY_PIXEL );
+  }
+
+  for ( long i = 0; i <= count; i++ )
+    colorText( p->rgb + i * BINARY_PIXEL, p->text + i * TEXT_PIXEL );
+
+  return p;
+}
+
+void freePalette( Palette *p )
+{
+  free( p->rgb );
+  free( p->text );
+  free( p );
+}
+
+Image *openImage( int width, int height, bool binary, Palette const *palette,
+                  char const *fname )
+{
+  Image *img = ( Image * ) malloc( sizeof( Image ) );
+  if ( img == NULL )
+    return NULL;
+
+  img->width = width;
+  img->height = height;
+  img->binary = binary;
+  img->rowBytes = binary ? ( long ) width * BINARY_PIXEL
+                         : ( long ) width * TEXT_PIXEL + 1;
+  img->fp = NULL;
+  img->buffer = NULL;
+  img->map = NULL;
+  img->fd = -1;
+  img->palette = palette;
+
+  char header[ HEADER_LIMIT ];
+  img->headerBytes = sprintf( header, "%s\n%d %d\n255\n", binary ? "P6" : "P3",
+                              width, height );
+
+  if ( fname == NULL ) {
+    img->fp = stdout;
+    img->buffer = ( unsigned char * ) malloc( img->rowBytes );
+    if ( img->buffer == NULL ) {
+      free( img );
+      return NULL;
+    }
+
+    fwrite( header, 1, img->headerBytes, img->fp );
+    return img;
+  }
+
+  // Size the file for the whole image and map it.
+  long total = img->headerBytes + img->rowBytes * height;
+  // Once the file is open, a failure removes it instead of leaving
+  // an empty or blank image behind.
+  img->fd = open( fname, O_RDWR | O_CREAT | O_TRUNC, 0644 );
+  if ( img->fd < 0 ) {
+    free( img );
+    return NULL;
+  }
+
+  if ( ftruncate( img->fd, total ) == 0 )
+    img->map = ( unsigned char * ) mmap( NULL, total, PROT_READ | PROT_WRITE,
+                                         MAP_SHARED, img->fd, 0 );
+  else
+    img->map = MAP_FAILED;
+  if ( img->map == MAP_FAILED ) {
+    close( img->fd );
+    unlink( fname );
+    free( img );
+    return NULL;
+  }
+
+  memcpy( img->map, header, img->headerBytes );
+  return img;
+}
+
+unsigned char *rowOf( Image *img, int row )
+{
+  if ( img->map )
+    return img->map + img->headerBytes + img->rowBytes * row;
+  return img->buffer;
+}
+
+void finishRow( Image *img, int row )
+{
+  writeRows( img, img->buffer, 1 );
+}
+
+void writeRows( Image *img, unsigned char const *rows, int count )
+{
+  if ( img->fp )
+    fwrite( rows, 1, img->rowBytes * count, img->fp );
+}
+
+void sampleColor( Palette const *p, int owner, double x, double y, unsigned char *rgb )
+{
+  unsigned char const *c = p->rgb + ( owner + 1L ) * BINARY_PIXEL;
+  int level = SHADE_LEVELS;
+  if ( p->shade && owner != NO_OWNER ) {
+    double dx = x - p->shade[ owner ].x;
+    double dy = y - p->shade[ owner ].y;
+    double f = 1 - sqrt( dx * dx + dy * dy ) * ( ( 1 - DARKEST ) / p->falloff );
+    level = ( f > DARKEST ? f : DARKEST ) * SHADE_LEVELS;
+  }
+
+  for ( int k = 0; k < BINARY_PIXEL; k++ )
+    rgb[ k ] = c[ k ] * level / SHADE_LEVELS;
+}
+
+void paintPixel( Image const *img, unsigned char const *rgb, int col, unsigned char *dest )
+{
+  if ( img->binary )
+    memcpy( dest + ( long ) col * BINARY_PIXEL, rgb, BINARY_PIXEL );
+  else
+    colorText( rgb, ( char * ) dest + ( long ) col * TEXT_PIXEL );
+}
+
+/**
+    Paints part of a row, darkening each pixel by its distance from
+    the seed that owns it.
+
+    @param img The image.
+    @param owners The owner of each pixel in the row.
+    @param row The row being painted.
+    @param first The first pixel to paint.
+    @param last One past the last pixel to paint.
+    @param dest Where the row starts.
+*/
+static void paintShaded( Image const *img, int const *owners, int row, int first, int last,
+                         unsigned char *dest )
+{
+  for ( int i = first; i < last; i++ ) {
+    unsigned char px[ BINARY_PIXEL ];
+    sampleColor( img->palette, owners[ i ], i, row, px );
+    paintPixel( img, px, i, dest );
+  }
+}
+
+void paintSpan( Image const *img, int const *owners, int row, int first, int last,
+                unsigned char *dest )
+{
+  Palette const *p = img->palette;
+
+  if ( p->shade ) {
+    paintShaded( img, owners, row, first, last, dest );
+  } else if ( img->binary ) {
+    for ( int i = first; i < last; i++ )
+      memcpy( dest + ( long ) i * BINARY_PIXEL, p->rgb + ( owners[ i ] + 1L ) * BINARY_PIXEL,
+              BINARY_PIXEL );
+  } else {
+    for ( int i = first; i < last; i++ )
+      memcpy( dest + ( long ) i * TEXT_PIXEL, p->text + ( owners[ i ] + 1L ) * TEXT_PIXEL,
+              TEXT_PIXEL );
+  }
+}
+
+void paintRow( Image const *img, int const *owners, int row, unsigned char *dest )
+{
+  paintSpan( img, owners, row, 0, img->width, dest );
+  if ( !img->binary )
+    dest[ img->rowBytes - 1 ] = '\n';
+}
+
+bool closeImage( Image *img )
+{
+  bool ok = true;
+
+  if ( img->map ) {
+    ok = munmap( img->map, img->headerBytes + img->rowBytes * img->height ) == 0;
+    ok = close( img->fd ) == 0 && ok;
+  } else {
+    ok = fflush( img->fp ) == 0 && !ferror( img->fp );
+  }
+
+  free( img->buffer );
+  free( img );
+  return ok;
+}
@@ -0,0 +1,190 @@
+/**
+    @file ppm.h
+    @author Nicholas Board (ndboard)
+
+    Contains the image writer used by voronoi.  Rows are painted
+    into a buffer and written out whole, either as text P3 or as
+    binary P6, to standard output or straight into a mapped file.
+    Colors come from a palette with an entry per seed, so painting
+    a pixel is just a table lookup.
+*/
+
+#ifndef _PPM_H_
+#define _PPM_H_
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "seed.h"
+
+/** Bytes used for one pixel in a text image, like "255   0   0 ". */
+#define TEXT_PIXEL 12
+
+/** Bytes used for one pixel in a binary image. */
+#define BINARY_PIXEL 3
+
+/** Colors for the seeds, looked up by owner. */
+typedef struct {
+  /** Number of seeds with a color. */
+  int count;
+
+  /** Packed colors, white for NO_OWNER first and then one per seed. */
+  unsigned char *rgb;
+
+  /** The same colors written out as text, TEXT_PIXEL bytes each. */
+  char *text;
+
+  /** Seeds to shade by distance from, or NULL for flat colors. */
+  Seed const *shade;
+
+  /** Distance at which shading reaches its darkest. */
+  double falloff;
+} Palette;
+
+/** Representation for an image being written out a row at a time. */
+typedef struct {
+  /** Size of the image in pixels. */
+  int width;
+  int height;
+
+  /** True for a binary P6 image, false for text P3. */
+  bool binary;
+
+  /** Number of bytes in one row, including any newline. */
+  long rowBytes;
+
+  /** Number of bytes in the header. */
+  long headerBytes;
+
+  /** Stream the rows are written to, or NULL for a mapped file. */
+  FILE *fp;
+
+  /** Buffer that holds a row until it's written to the stream. */
+  unsigned char *buffer;
+
+  /** The mapped output file, when there's no stream. */
+  unsigned char *map;
+
+  /** Descriptor of the mapped output file. */
+  int fd;
+
+  /** Colors to paint with. */
+  Palette const *palette;
+} Image;
+
+/**
+    Builds the colors for a number of seeds.  The classic palette
+    cycles through twelve fixed colors, and the generated one gives
+    every seed its own hue, spaced by the golden ratio so neighbors
+    in the input look different.  Colors start out flat.
+
+    @param count The number of seeds.
+    @param generated True for generated hues, false for the classic colors.
+    @return The new palette, or NULL if it can't be allocated.
+*/
+Palette *buildPalette( int count, bool generated );
+
+/**
+    Frees a palette's allocated space.
+
+    @param p The palette to free.
+*/
+void freePalette( Palette *p );
+
+/**
+    Starts an image and writes its header.  With a file name the
+    output file is sized up front and mapped, so rows are painted
+    in place with no copying or write calls.
+
+    @param width The width of the image.
+    @param height The height of the image.
+    @param binary True to write P6, false to write P3.
+    @param palette The colors to paint with, which have to outlive the image.
+    @param fname The file to map, or NULL to write to standard output.
+    @return The new image, or NULL if the output can't be set up.
+*/
+Image *openImage( int width, int height, bool binary, Palette const *palette,
+                  char const *fname );
+
+/**
+    Gets the place to paint the given row.  Rows have to be
+    finished in order when writing to a stream.
+
+    @param img The image.
+    @param row The row about to be painted.
+    @return Where the row's bytes go.
+*/
+unsigned char *rowOf( Image *img, int row );
+
+/**
+    Writes out a painted row with one call, if it isn't mapped.
+
+    @param img The image.
+    @param row The row that was painted.
+*/
+void finishRow( Image *img, int row );
+
+/**
+    Writes out a band of painted rows with one call.  Mapped
+    images are painted in place, so nothing is written for them.
+
+    @param img The image.
+    @param rows The painted rows, one after another.
+    @param count The number of rows.
+*/
+void writeRows( Image *img, unsigned char const *rows, int count );
+
+/**
+    Paints a row of owners in the image's format.
+
+    @param img The image.
+    @param owners The owner of each pixel in the row.
+    @param row The row being painted, for shading.
+    @param dest Where to paint the row, rowBytes long.
+*/
+void paintRow( Image const *img, int const *owners, int row, unsigned char *dest );
+
+/**
+    Paints part of a row of owners in the image's format, leaving
+    the rest of the row alone.
+
+    @param img The image.
+    @param owners The owner of each pixel in the row.
+    @param row The row being painted, for shading.
+    @param first The first pixel to paint.
+    @param last One past the last pixel to paint.
+    @param dest Where the row starts.
+*/
+void paintSpan( Image const *img, int const *owners, int row, int first, int last,
+                unsigned char *dest );
+
+/**
+    Gets the color a point owned by a seed is painted, shaded by
+    the point's distance from the seed if the palette shades.
+
+    @param p The palette.
+    @param owner The owning seed, or NO_OWNER.
+    @param x The x coordinate of the point.
+    @param y The y coordinate of the point.
+    @param rgb Filled with the color.
+*/
+void sampleColor( Palette const *p, int owner, double x, double y, unsigned char *rgb );
+
+/**
+    Paints one pixel of a row with a given color.
+
+    @param img The image.
+    @param rgb The color.
+    @param col The column of the pixel.
+    @param dest Where the row starts.
+*/
+void paintPixel( Image const *img, unsigned char const *rgb, int col, unsigned char *dest );
+
+/**
+    Flushes an image and frees its allocated space.
+
+    @param img The image to close.
+    @return True if all the output was written successfully.
+*/
+bool closeImage( Image *img );
+
+#endif
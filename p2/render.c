@@ -0,0 +1,386 @@
+/**
+    @file render.c
+    @author Nicholas Board (ndboard)
+
+    Labels and paints the rows of the image.  In parallel, rows are
+    grouped into bands, each worker claims the next band, paints it
+    into one of a ring of buffers, and the calling thread writes the
+    finished bands out in order.  When smoothing, only the pixels on
+    a cell boundary are supersampled, so the extra work grows with
+    the length of the boundaries rather than the area.
+*/
+
+#include<stdlib.h>
+#include<pthread.h>
+#include"render.h"
+#include"edt.h"
+#include"scan.h"
+
+/** Roughly how many bytes of output go in one band. */
+#define BAND_BYTES ( 1 << 20 )
+
+/** Number of band buffers per worker, so workers can run ahead. */
+#define BUFFERS_PER_THREAD 2
+
+/** Samples along each side of a pixel that's smoothed. */
+#define SAMPLES 4
+
+/** Per thread state for labeling rows. */
+typedef struct {
+  /** Tree over the seeds. */
+  KDTree const *tree;
+
+  /** Metric to label with, or NULL for Euclidean. */
+  Metric const *metric;
+
+  /** This thread's distance transform, or NULL. */
+  Transform *edt;
+
+  /** Seeds laid out for the vector scan, or NULL to search the tree. */
+  SeedBlock *scan;
+
+  /** Owners of the row being labeled. */
+  int *owners;
+
+  /** Whether boundary pixels are supersampled. */
+  bool smooth;
+
+  /** Owners of the rows above and below, when smoothing. */
+  int *above;
+  int *below;
+
+  /** The row whose owners are in owners, or -1. */
+  int center;
+} Labeler;
+
+/** State shared by the threads rendering one image. */
+typedef struct {
+  /** The image being rendered. */
+  Image *img;
+
+  /** Rows in each band, and the number of bands. */
+  int bandRows;
+  int bands;
+
+  /** Ring of band buffers, and how many there are. */
+  unsigned char **buffers;
+  int slots;
+
+  /** Next band to be claimed by a worker. */
+  int next;
+
+  /** Bands before this one have been written out. */
+  int written;
+
+  /** Whether each band has been painted. */
+  bool *done;
+
+  /** Guards the fields above, and signals changes to them. */
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+} Pool;
+
+/** What each worker thread is given. */
+typedef struct {
+  Pool *pool;
+  Labeler labeler;
+} Worker;
+
+/**
+    Sets up the state for labeling rows.
+
+    @param l The labeler to set up.
+    @param tree Tree over the seeds.
+    @param metric Metric to label with, or NULL for Euclidean.
+    @param transform True to use the distance transform.
+    @param smooth True to supersample boundary pixels.
+    @param width The width of the rows.
+    @return True if the space could be allocated.
+*/
+static bool initLabeler( Labeler *l, KDTree const *tree, Metric const *metric,
+                         bool transform, bool smooth, int width )
+{
+  transform = transform && metric == NULL;
+  l->tree = tree;
+  l->metric = metric;
+  l->edt = transform ? buildTransform( tree ) : NULL;
+  l->scan = NULL;
+  if ( !transform && metric == NULL && tree->count <= scanLimit() )
+    l->scan = buildBlock( tree->list, tree->count );
+  l->owners = ( int * ) malloc( width * sizeof( int ) );
+  l->smooth = smooth;
+  l->above = smooth ? ( int * ) malloc( width * sizeof( int ) ) : NULL;
+  l->below = smooth ? ( int * ) malloc( width * sizeof( int ) ) : NULL;
+  l->center = -1;
+  return l->owners != NULL && ( !transform || l->edt != NULL ) &&
+         ( !smooth || ( l->above != NULL && l->below != NULL ) );
+}
+
+/**
+    Frees the space held by a labeler.
+
+    @param l The labeler to free.
+*/
+static void freeLabeler( Labeler *l )
+{
+  if ( l->edt )
+    freeTransform( l->edt );
+  if ( l->scan )
+    freeBlock( l->scan );
+  free( l->owners );
+  free( l->above );
+  free( l->below );
+}
+
+/**
+    Labels a row with the labeler's engine.  When searching the tree,
+    the owner of the previous pixel is passed along since it's
+    usually the owner of the next.
+
+    @param l The labeler.
+    @param row The row to label.
+    @param width The width of the row.
+    @param owners Filled with the owner of each pixel.
+*/
+static void labelRow( Labeler *l, int row, int width, int *owners )
+{
+  if ( l->metric ) {
+    metricRow( l->metric, row, width, owners );
+  } else if ( l->edt ) {
+    transformRow( l->edt, row, width, owners );
+  } else if ( l->scan ) {
+    scanRow( l->scan, row, width, owners );
+  } else {
+    int owner = NO_OWNER;
+    for ( int j = 0; j < width; j++ )
+      owner = owners[ j ] = nearestInTree( l->tree, j, row, owner );
+  }
+}
+
+/**
+    Repaints the pixels of a row that sit on a cell boundary with the
+    average color of a grid of samples inside them.  A pixel is on a
+    boundary if a pixel beside, above or below it has another owner.
+    White pixels mark seeds, so they're left alone.
+
+    @param l The labeler, holding the row and its neighbors.
+    @param img The image.
+    @param row The row being painted.
+    @param dest Where the row starts.
+*/
+static void smoothRow( Labeler const *l, Image const *img, int row, unsigned char *dest )
+{
+  int const *owners = l->owners;
+  int width = img->width;
+
+  for ( int j = 0; j < width; j++ ) {
+    int o = owners[ j ];
+    if ( o == NO_OWNER ||
+         !( ( j > 0 && owners[ j - 1 ] != o ) || ( j + 1 < width && owners[ j + 1 ] != o ) ||
+            ( row > 0 && l->above[ j ] != o ) || ( row + 1 < img->height && l->below[ j ] != o ) ) )
+      continue;
+
+    int sum[ BINARY_PIXEL ] = { 0, 0, 0 };
+    int hint = o;
+    for ( int a = 0; a < SAMPLES; a++ )
+      for ( int b = 0; b < SAMPLES; b++ ) {
+        double x = j + ( b + 0.5 ) / SAMPLES - 0.5;
+        double y = row + ( a + 0.5 ) / SAMPLES - 0.5;
+        hint = l->metric ? l->metric->nearestAt( l->metric, x, y, hint )
+                         : nearestPoint( l->tree, x, y, hint );
+
+        unsigned char c[ BINARY_PIXEL ];
+        sampleColor( img->palette, hint, x, y, c );
+        for ( int k = 0; k < BINARY_PIXEL; k++ )
+          sum[ k ] += c[ k ];
+      }
+
+    unsigned char avg[ BINARY_PIXEL ];
+    for ( int k = 0; k < BINARY_PIXEL; k++ )
+      avg[ k ] = ( sum[ k ] + SAMPLES * SAMPLES / 2 ) / ( SAMPLES * SAMPLES );
+    paintPixel( img, avg, j, dest );
+  }
+}
+
+/**
+    Labels a row and paints it.  When smoothing, the rows above and
+    below are kept labeled too, sliding the window down when rows are
+    rendered in order.
+
+    @param l The labeler.
+    @param img The image.
+    @param row The row to render.
+    @param dest Where to paint the row.
+*/
+static void renderRow( Labeler *l, Image const *img, int row, unsigned char *dest )
+{
+  if ( !l->smooth ) {
+    labelRow( l, row, img->width, l->owners );
+    paintRow( img, l->owners, row, dest );
+    return;
+  }
+
+  if ( row == l->center + 1 && l->center >= 0 ) {
+    int *old = l->above;
+    l->above = l->owners;
+    l->owners = l->below;
+    l->below = old;
+  } else {
+    if ( row > 0 )
+      labelRow( l, row - 1, img->width, l->above );
+    labelRow( l, row, img->width, l->owners );
+  }
+
+  l->center = row;
+  if ( row + 1 < img->height )
+    labelRow( l, row + 1, img->width, l->below );
+
+  paintRow( img, l->owners, row, dest );
+  smoothRow( l, img, row, dest );
+}
+
+/**
+    Renders bands until there are none left to claim.
+
+    @param arg The worker's state.
+    @return Always NULL.
+*/
+static void *work( void *arg )
+{
+  Worker *w = ( Worker * ) arg;
+  Pool *p = w->pool;
+  Image *img = p->img;
+
+  pthread_mutex_lock( &p->lock );
+  while ( p->next < p->bands ) {
+    int band = p->next++;
+
+    // Wait for the band that last used this buffer to be written.
+    while ( band - p->written >= p->slots )
+      pthread_cond_wait( &p->changed, &p->lock );
+    pthread_mutex_unlock( &p->lock );
+
+    int first = band * p->bandRows;
+    int last = first + p->bandRows < img->height ? first + p->bandRows : img->height;
+    unsigned char *buf = p->buffers[ band % p->slots ];
+
+    for ( int row = first; row < last; row++ ) {
+      unsigned char *dest = img->map ? rowOf( img, row )
+                                     : buf + img->rowBytes * ( row - first );
+      renderRow( &w->labeler, img, row, dest );
+    }
+
+    pthread_mutex_lock( &p->lock );
+    p->done[ band ] = true;
+    pthread_cond_broadcast( &p->changed );
+  }
+  pthread_mutex_unlock( &p->lock );
+
+  return NULL;
+}
+
+/**
+    Renders with a pool of threads, writing bands out in order.
+
+    @param tree Tree over the seeds.
+    @param metric Metric to label with, or NULL for Euclidean.
+    @param transform True to use the distance transform.
+    @param smooth True to supersample boundary pixels.
+    @param img The image to render into.
+    @param threads The number of worker threads.
+    @return True if the state could be allocated.
+*/
+static bool renderParallel( KDTree const *tree, Metric const *metric, bool transform,
+                            bool smooth, Image *img, int threads )
+{
+  Pool p;
+  p.img = img;
+  p.bandRows = BAND_BYTES / img->rowBytes > 0 ? BAND_BYTES / img->rowBytes : 1;
+  p.bands = ( img->height + p.bandRows - 1 ) / p.bandRows;
+  p.slots = img->map ? p.bands : threads * BUFFERS_PER_THREAD;
+  p.next = 0;
+  p.written = 0;
+  p.done = ( bool * ) calloc( p.bands, sizeof( bool ) );
+  p.buffers = ( unsigned char ** ) calloc( p.slots, sizeof( unsigned char * ) );
+  pthread_mutex_init( &p.lock, NULL );
+  pthread_cond_init( &p.changed, NULL );
+
+  Worker *workers = ( Worker * ) calloc( threads, sizeof( Worker ) );
+  pthread_t *ids = ( pthread_t * ) malloc( threads * sizeof( pthread_t ) );
+  bool ok = p.done && p.buffers && workers && ids;
+
+  // Mapped images are painted in place, so they need no buffers.
+  for ( int i = 0; ok && !img->map && i < p.slots; i++ ) {
+    p.buffers[ i ] = ( unsigned char * ) malloc( img->rowBytes * p.bandRows );
+    ok = p.buffers[ i ] != NULL;
+  }
+
+  // Transforms are built here, since building one isn't thread safe.
+  for ( int i = 0; ok && i < threads; i++ ) {
+    workers[ i ].pool = &p;
+    ok = initLabeler( &workers[ i ].labeler, tree, metric, transform, smooth,
+                      img->width );
+  }
+
+  int started = 0;
+  while ( ok && started < threads &&
+          pthread_create( &ids[ started ], NULL, work, &workers[ started ] ) == 0 )
+    started++;
+
+  // Without any workers there's nothing to wait for.
+  if ( started == 0 )
+    p.bands = 0;
+
+  // Write out each band once it's painted.
+  pthread_mutex_lock( &p.lock );
+  while ( p.written < p.bands ) {
+    while ( !p.done[ p.written ] )
+      pthread_cond_wait( &p.changed, &p.lock );
+    pthread_mutex_unlock( &p.lock );
+
+    int first = p.written * p.bandRows;
+    int rows = img->height - first < p.bandRows ? img->height - first : p.bandRows;
+    writeRows( img, p.buffers[ p.written % p.slots ], rows );
+
+    pthread_mutex_lock( &p.lock );
+    p.written++;
+    pthread_cond_broadcast( &p.changed );
+  }
+  pthread_mutex_unlock( &p.lock );
+
+  for ( int i = 0; i < started; i++ )
+    pthread_join( ids[ i ], NULL );
+
+  for ( int i = 0; workers && i < threads; i++ )
+    if ( workers[ i ].pool )
+      freeLabeler( &workers[ i ].labeler );
+  for ( int i = 0; p.buffers && i < p.slots; i++ )
+    free( p.buffers[ i ] );
+
+  free( ids );
+  free( workers );
+  free( p.buffers );
+  free( p.done );
+  pthread_mutex_destroy( &p.lock );
+  pthread_cond_destroy( &p.changed );
+
+  return ok && started > 0;
+}
+
+bool renderImage( KDTree const *tree, Metric const *metric, bool transform,
+                  bool smooth, Image *img, int threads )
+{
+  if ( threads > 1 )
+    return renderParallel( tree, metric, transform, smooth, img, threads );
+
+  Labeler l;
+  bool ok = initLabeler( &l, tree, metric, transform, smooth, img->width );
+
+  for ( int i = 0; ok && i < img->height; i++ ) {
+    renderRow( &l, img, i, rowOf( img, i ) );
+    finishRow( img, i );
+  }
+
+  freeLabeler( &l );
+  return ok;
+}
@@ -0,0 +1,38 @@
+/**
+    @file render.h
+    @author Nicholas Board (ndboard)
+
+    Contains the driver that labels and paints every row of the
+    image, either on the calling thread or on a pool of threads.
+*/
+
+#ifndef _RENDER_H_
+#define _RENDER_H_
+
+#include <stdbool.h>
+#include "kdtree.h"
+#include "metric.h"
+#include "ppm.h"
+
+/** Most threads that can be asked for. */
+#define MAX_THREADS 256
+
+/**
+    Renders the diagram into the image.  With more than one thread,
+    bands of rows are rendered in parallel into their own buffers
+    and written out in order, so the output is the same as with one.
+
+    @param tree Tree over the seeds.
+    @param metric Metric to label with, or NULL for Euclidean.
+    @param transform True to label rows with the distance transform,
+                     which is only done for Euclidean diagrams.
+    @param smooth True to anti-alias cell boundaries by supersampling
+                  just the pixels on them.
+    @param img The image to render into.
+    @param threads The number of threads to render with.
+    @return True if the rendering state could be allocated.
+*/
+bool renderImage( KDTree const *tree, Metric const *metric, bool transform,
+                  bool smooth, Image *img, int threads );
+
+#endif
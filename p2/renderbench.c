@@ -0,0 +1,198 @@
+/**
+  @file renderbench.c
+  @file Nicholas Board (ndboard)
+
+  This program benchmarks the whole voronoi render path.  It runs
+  ./voronoi over generated seed sets for a sweep of canvas sizes,
+  seed counts and thread counts, and reports the pixels rendered
+  per second, megabytes of output per second, and the peak memory
+  of each run.  Any arguments are passed on to voronoi in place of
+  the default -b, so other engines and formats can be measured,
+  like ./renderbench -b -e.
+*/
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<stdbool.h>
+#include<time.h>
+#include<unistd.h>
+#include<sys/types.h>
+#include<sys/time.h>
+#include<sys/resource.h>
+#include<sys/wait.h>
+
+// Controls the parameters.
+#define SIZES 3
+#define SEED_COUNTS 3
+#define THREAD_COUNTS 2
+#define MAX_ARGS 32
+#define ARG_LENGTH 16
+#define CHUNK 65536
+#define FAILED_EXIT 1
+
+// Canvas sides, seed counts and thread counts swept.
+static int const sizes[ SIZES ] = { 256, 1024, 4096 };
+static int const seedCounts[ SEED_COUNTS ] = { 16, 1024, 65536 };
+static int const threadCounts[ THREAD_COUNTS ] = { 1, 4 };
+
+/** What one run of voronoi measured. */
+typedef struct {
+  /** Seconds from start to exit. */
+  double seconds;
+
+  /** Bytes written to standard output. */
+  long bytes;
+
+  /** Peak resident memory in kilobytes. */
+  long peak;
+} Run;
+
+/**
+  Gets the current time in seconds.
+
+  @return seconds on a monotonic clock
+*/
+static double now( void )
+{
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+  Writes a counted seed set spread evenly over a canvas to a
+  temporary file.
+
+  @param count The number of seeds.
+  @param side The side of the canvas.
+  @return The file, rewound, or NULL if it can't be made.
+*/
+static FILE *makeSeeds( int count, int side )
+{
+  FILE *fp = tmpfile();
+  if ( fp == NULL )
+    return NULL;
+
+  fprintf( fp, "%d\n", count );
+  for ( int i = 0; i < count; i++ )
+    fprintf( fp, "%.2f %.2f\n", rand() / ( RAND_MAX + 1.0 ) * side,
+             rand() / ( RAND_MAX + 1.0 ) * side );
+
+  rewind( fp );
+  return fp;
+}
+
+/**
+  Runs voronoi once, counting its output and measuring its memory.
+
+  @param args Arguments for voronoi, ending with NULL.
+  @param seeds The seed file to read from.
+  @param run Filled with the measurements.
+  @return True if voronoi ran and exited successfully.
+*/
+static bool runVoronoi( char *const args[], FILE *seeds, Run *run )
+{
+  int out[ 2 ];
+  if ( pipe( out ) != 0 )
+    return false;
+
+  rewind( seeds );
+  double start = now();
+  pid_t pid = fork();
+  if ( pid < 0 ) {
+    close( out[ 0 ] );
+    close( out[ 1 ] );
+    return false;
+  }
+
+  if ( pid == 0 ) {
+    dup2( fileno( seeds ), STDIN_FILENO );
+    dup2( out[ 1 ], STDOUT_FILENO );
+    close( out[ 0 ] );
+    close( out[ 1 ] );
+    execv( args[ 0 ], args );
+    _exit( FAILED_EXIT );
+  }
+
+  // Drain the image, just counting it.
+  close( out[ 1 ] );
+  static char buffer[ CHUNK ];
+  ssize_t len;
+  run->bytes = 0;
+  while ( ( len = read( out[ 0 ], buffer, CHUNK ) ) > 0 )
+    run->bytes += len;
+  close( out[ 0 ] );
+
+  int status;
+  struct rusage usage;
+  if ( wait4( pid, &status, 0, &usage ) != pid )
+    return false;
+
+  run->seconds = now() - start;
+  run->peak = usage.ru_maxrss;
+  return WIFEXITED( status ) && WEXITSTATUS( status ) == 0;
+}
+
+/**
+  Where the program begins.
+
+  @param argc The number of command-line arguments.
+  @param argv Flags to pass on to voronoi.
+  @return program exit status
+*/
+int main( int argc, char *argv[] )
+{
+  if ( argc + 10 > MAX_ARGS ) {
+    fprintf( stderr, "usage: renderbench [voronoi flags]\n" );
+    return FAILED_EXIT;
+  }
+
+  char side[ ARG_LENGTH ];
+  char threads[ ARG_LENGTH ];
+  char *args[ MAX_ARGS ] = { "./voronoi", "-n", "-w", side, "-h", side, "-j", threads };
+  int fixed = 8;
+  if ( argc > 1 ) {
+    for ( int i = 1; i < argc; i++ )
+      args[ fixed++ ] = argv[ i ];
+  } else {
+    args[ fixed++ ] = "-b";
+  }
+  args[ fixed ] = NULL;
+
+  srand( 230 );
+  printf( "%6s %7s %7s %9s %10s %9s %8s\n", "size", "seeds", "threads", "seconds",
+          "Mpixels/s", "MB/s", "peak MB" );
+
+  for ( int s = 0; s < SIZES; s++ )
+    for ( int c = 0; c < SEED_COUNTS; c++ ) {
+      FILE *seeds = makeSeeds( seedCounts[ c ], sizes[ s ] );
+      if ( seeds == NULL ) {
+        fprintf( stderr, "Can't make seed file\n" );
+        return FAILED_EXIT;
+      }
+
+      for ( int t = 0; t < THREAD_COUNTS; t++ ) {
+        sprintf( side, "%d", sizes[ s ] );
+        sprintf( threads, "%d", threadCounts[ t ] );
+
+        Run run;
+        if ( !runVoronoi( args, seeds, &run ) ) {
+          fprintf( stderr, "voronoi failed at size %d with %d seeds\n", sizes[ s ],
+                   seedCounts[ c ] );
+          return FAILED_EXIT;
+        }
+
+        double pixels = ( double ) sizes[ s ] * sizes[ s ];
+        printf( "%6d %7d %7d %9.3f %10.1f %9.1f %8.1f\n", sizes[ s ], seedCounts[ c ],
+                threadCounts[ t ], run.seconds, pixels / run.seconds / 1e6,
+                run.bytes / run.seconds / 1e6, run.peak / 1024.0 );
+        fflush( stdout );
+      }
+
+      fclose( seeds );
+    }
+
+  // Exits the program successfully.
+  return 0;
+}
@@ -0,0 +1,257 @@
+/**
+    @file scan.c
+    @author Nicholas Board (ndboard)
+
+    Finds owners by comparing squared distances to every seed, for
+    four pixels per instruction with AVX2, two with SSE2, or one at
+    a time on other processors.  Each vector lane is a pixel that
+    walks the seeds in order and only moves to a strictly closer
+    one, so it ends on the lowest indexed closest seed, just like
+    the scalar rule.
+
+    The lanes are doubles, not floats, even though floats would fit
+    twice as many.  Coordinates run to 65536, so squared distances
+    take up to 33 bits, more than a float holds exactly, and rounded
+    distances would break ties differently than nearestInTree().
+*/
+
+#include<stdlib.h>
+#include"scan.h"
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#define SCAN_X86
+#include<immintrin.h>
+#endif
+
+SeedBlock *buildBlock( Seed const *list, int count )
+{
+  SeedBlock *b = ( SeedBlock * ) malloc( sizeof( SeedBlock ) );
+  if ( b == NULL )
+    return NULL;
+
+  b->list = list;
+  b->count = count;
+  b->xs = ( double * ) malloc( count * sizeof( double ) );
+  b->ys = ( double * ) malloc( count * sizeof( double ) );
+  if ( b->xs == NULL || b->ys == NULL ) {
+    freeBlock( b );
+    return NULL;
+  }
+
+  for ( int i = 0; i < count; i++ ) {
+    b->xs[ i ] = list[ i ].x;
+    b->ys[ i ] = list[ i ].y;
+  }
+
+  return b;
+}
+
+void freeBlock( SeedBlock *b )
+{
+  free( b->xs );
+  free( b->ys );
+  free( b );
+}
+
+/**
+    Finishes a row whose closest seeds are known.  Where that seed
+    rounds to the pixel, the white rule needs every tied seed, so
+    the pixel is settled by a full scalar pass.  This runs outside
+    the vector kernels, so they never call out with wide registers
+    live.
+
+    @param b The seeds.
+    @param row The row.
+    @param width The number of pixels in the row.
+    @param owners The lowest indexed closest seed for each pixel,
+                  replaced by the pixel's owner.
+*/
+static void settleRow( SeedBlock const *b, int row, int width, int *owners )
+{
+  for ( int col = 0; col < width; col++ ) {
+    Seed const *s = &b->list[ owners[ col ] ];
+    if ( s->col != col || s->row != row )
+      continue;
+
+    Nearest best;
+    initNearest( &best );
+    for ( int i = 0; i < b->count; i++ )
+      considerSeed( &best, b->list, i, col, row );
+    owners[ col ] = best.owner;
+  }
+}
+
+/**
+    Labels a row with each pixel's lowest indexed closest seed,
+    one seed at a time.
+
+    @param b The seeds to scan.
+    @param row The row to label.
+    @param width The number of pixels in the row.
+    @param owners Filled with the closest seed for each pixel.
+*/
+static void closestScalar( SeedBlock const *b, int row, int width, int *owners )
+{
+  for ( int col = 0; col < width; col++ ) {
+    double best = INFINITY;
+    int owner = 0;
+
+    for ( int i = 0; i < b->count; i++ ) {
+      double dx = col - b->xs[ i ];
+      double dy = row - b->ys[ i ];
+      double d = dx * dx + dy * dy;
+
+      if ( d < best ) {
+        best = d;
+        owner = i;
+      }
+    }
+
+    owners[ col ] = owner;
+  }
+}
+
+#ifdef SCAN_X86
+
+/**
+    Labels a row like closestScalar(), four pixels at a time with
+    SSE2, as two vectors of two so the compare and blend chains can
+    overlap.
+
+    @param b The seeds to scan.
+    @param row The row to label.
+    @param width The number of pixels in the row.
+    @param owners Filled with the closest seed for each pixel.
+*/
+__attribute__(( target( "sse2" ) ))
+static void closestSSE2( SeedBlock const *b, int row, int width, int *owners )
+{
+  for ( int col = 0; col < width; col += 4 ) {
+    __m128d px0 = _mm_set_pd( col + 1, col );
+    __m128d px1 = _mm_set_pd( col + 3, col + 2 );
+    __m128d best0 = _mm_set1_pd( INFINITY );
+    __m128d best1 = best0;
+    __m128d idx0 = _mm_setzero_pd();
+    __m128d idx1 = idx0;
+
+    for ( int i = 0; i < b->count; i++ ) {
+      double dy = row - b->ys[ i ];
+      __m128d sx = _mm_set1_pd( b->xs[ i ] );
+      __m128d dy2 = _mm_set1_pd( dy * dy );
+      __m128d si = _mm_set1_pd( i );
+
+      __m128d dx0 = _mm_sub_pd( px0, sx );
+      __m128d dx1 = _mm_sub_pd( px1, sx );
+      __m128d d0 = _mm_add_pd( _mm_mul_pd( dx0, dx0 ), dy2 );
+      __m128d d1 = _mm_add_pd( _mm_mul_pd( dx1, dx1 ), dy2 );
+
+      // Take the new seed only where it's strictly closer.
+      __m128d c0 = _mm_cmplt_pd( d0, best0 );
+      __m128d c1 = _mm_cmplt_pd( d1, best1 );
+      best0 = _mm_or_pd( _mm_and_pd( c0, d0 ), _mm_andnot_pd( c0, best0 ) );
+      best1 = _mm_or_pd( _mm_and_pd( c1, d1 ), _mm_andnot_pd( c1, best1 ) );
+      idx0 = _mm_or_pd( _mm_and_pd( c0, si ), _mm_andnot_pd( c0, idx0 ) );
+      idx1 = _mm_or_pd( _mm_and_pd( c1, si ), _mm_andnot_pd( c1, idx1 ) );
+    }
+
+    double which[ 4 ];
+    _mm_storeu_pd( which, idx0 );
+    _mm_storeu_pd( which + 2, idx1 );
+    for ( int j = 0; j < 4 && col + j < width; j++ )
+      owners[ col + j ] = which[ j ];
+  }
+}
+
+/**
+    Labels a row like closestScalar(), eight pixels at a time with
+    AVX2, as two vectors of four so the compare and blend chains
+    can overlap.
+
+    @param b The seeds to scan.
+    @param row The row to label.
+    @param width The number of pixels in the row.
+    @param owners Filled with the closest seed for each pixel.
+*/
+__attribute__(( target( "avx2" ) ))
+static void closestAVX2( SeedBlock const *b, int row, int width, int *owners )
+{
+  for ( int col = 0; col < width; col += 8 ) {
+    __m256d px0 = _mm256_set_pd( col + 3, col + 2, col + 1, col );
+    __m256d px1 = _mm256_set_pd( col + 7, col + 6, col + 5, col + 4 );
+    __m256d best0 = _mm256_set1_pd( INFINITY );
+    __m256d best1 = best0;
+    __m256d idx0 = _mm256_setzero_pd();
+    __m256d idx1 = idx0;
+
+    for ( int i = 0; i < b->count; i++ ) {
+      double dy = row - b->ys[ i ];
+      __m256d sx = _mm256_set1_pd( b->xs[ i ] );
+      __m256d dy2 = _mm256_set1_pd( dy * dy );
+      __m256d si = _mm256_set1_pd( i );
+
+      __m256d dx0 = _mm256_sub_pd( px0, sx );
+      __m256d dx1 = _mm256_sub_pd( px1, sx );
+      __m256d d0 = _mm256_add_pd( _mm256_mul_pd( dx0, dx0 ), dy2 );
+      __m256d d1 = _mm256_add_pd( _mm256_mul_pd( dx1, dx1 ), dy2 );
+
+      // Take the new seed only where it's strictly closer.
+      __m256d c0 = _mm256_cmp_pd( d0, best0, _CMP_LT_OQ );
+      __m256d c1 = _mm256_cmp_pd( d1, best1, _CMP_LT_OQ );
+      best0 = _mm256_blendv_pd( best0, d0, c0 );
+      best1 = _mm256_blendv_pd( best1, d1, c1 );
+      idx0 = _mm256_blendv_pd( idx0, si, c0 );
+      idx1 = _mm256_blendv_pd( idx1, si, c1 );
+    }
+
+    double which[ 8 ];
+    _mm256_storeu_pd( which, idx0 );
+    _mm256_storeu_pd( which + 4, idx1 );
+    for ( int j = 0; j < 8 && col + j < width; j++ )
+      owners[ col + j ] = which[ j ];
+  }
+}
+
+#endif
+
+void scanRowScalar( SeedBlock const *b, int row, int width, int *owners )
+{
+  closestScalar( b, row, width, owners );
+  settleRow( b, row, width, owners );
+}
+
+void scanRow( SeedBlock const *b, int row, int width, int *owners )
+{
+#ifdef SCAN_X86
+  if ( __builtin_cpu_supports( "avx2" ) )
+    closestAVX2( b, row, width, owners );
+  else if ( __builtin_cpu_supports( "sse2" ) )
+    closestSSE2( b, row, width, owners );
+  else
+    closestScalar( b, row, width, owners );
+#else
+  closestScalar( b, row, width, owners );
+#endif
+  settleRow( b, row, width, owners );
+}
+
+char const *scanKernel( void )
+{
+#ifdef SCAN_X86
+  if ( __builtin_cpu_supports( "avx2" ) )
+    return "avx2";
+  if ( __builtin_cpu_supports( "sse2" ) )
+    return "sse2";
+#endif
+  return "scalar";
+}
+
+int scanLimit( void )
+{
+#ifdef SCAN_X86
+  if ( __builtin_cpu_supports( "avx2" ) )
+    return 112;
+  if ( __builtin_cpu_supports( "sse2" ) )
+    return 56;
+#endif
+  return 32;
+}
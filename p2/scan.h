@@ -0,0 +1,84 @@
+/**
+    @file scan.h
+    @author Nicholas Board (ndboard)
+
+    Contains the vectorized linear scan, which finds the owners of
+    several pixels at a time by checking every seed.  For small seed
+    counts this beats walking the k-d tree.
+*/
+
+#ifndef _SCAN_H_
+#define _SCAN_H_
+
+#include "seed.h"
+
+/** Seed coordinates laid out for the vector kernels. */
+typedef struct {
+  /** The seeds, in the order they were given. */
+  Seed const *list;
+
+  /** Number of seeds. */
+  int count;
+
+  /** Seed coordinates, each in its own array. */
+  double *xs;
+  double *ys;
+} SeedBlock;
+
+/**
+    Lays out the given seeds for scanning.  The seed list is not
+    copied, so it has to outlive the block.
+
+    @param list The seeds.
+    @param count The number of seeds.
+    @return The new block, or NULL if it can't be allocated.
+*/
+SeedBlock *buildBlock( Seed const *list, int count );
+
+/**
+    Frees a block's allocated space.
+
+    @param b The block to free.
+*/
+void freeBlock( SeedBlock *b );
+
+/**
+    Labels one row with the owner of each pixel, with the widest
+    vector kernel the processor supports.  This gives the same
+    owners as nearestInTree().
+
+    @param b The seeds to scan.
+    @param row The row to label.
+    @param width The number of pixels in the row.
+    @param owners Filled with the owner of each pixel.
+*/
+void scanRow( SeedBlock const *b, int row, int width, int *owners );
+
+/**
+    Labels one row like scanRow(), but one seed at a time, for
+    comparison with the vector kernels.
+
+    @param b The seeds to scan.
+    @param row The row to label.
+    @param width The number of pixels in the row.
+    @param owners Filled with the owner of each pixel.
+*/
+void scanRowScalar( SeedBlock const *b, int row, int width, int *owners );
+
+/**
+    Gets the name of the kernel scanRow() uses on this processor.
+
+    @return "avx2", "sse2" or "scalar".
+*/
+char const *scanKernel( void );
+
+/**
+    Gets the most seeds scanRow() is worth using for on this
+    processor, about where scanbench measures it falling behind the
+    k-d tree.  The narrower the kernel, the sooner that is.
+
+    @return The most seeds to scan.
+*/
+int scanLimit( void );
+
+#endif
@@ -0,0 +1,112 @@
+/**
+  @file scanbench.c
+  @file Nicholas Board (ndboard)
+
+  This program times the ways voronoi can find the owners of a
+  row: the k-d tree, a scalar scan of every seed, and the vector
+  scan.  It checks they agree, and prints nanoseconds per pixel
+  for a range of seed counts so the crossover can be seen.
+*/
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<time.h>
+#include"seed.h"
+#include"kdtree.h"
+#include"scan.h"
+
+// Controls the parameters.
+#define SIDE 512
+#define SEED_COUNTS 8
+#define MISMATCH_EXIT 1
+
+// Seed counts to time.
+static int const seedCounts[ SEED_COUNTS ] = { 3, 8, 16, 32, 64, 128, 512, 2048 };
+
+/**
+  Gets the current time in seconds.
+
+  @return seconds on a monotonic clock
+*/
+static double now( void )
+{
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+  Labels the rows of the canvas with the tree.
+
+  @param tree The tree to search.
+  @param owners Filled with every pixel's owner.
+*/
+static void treeImage( KDTree const *tree, int *owners )
+{
+  for ( int row = 0; row < SIDE; row++ ) {
+    int owner = NO_OWNER;
+    for ( int col = 0; col < SIDE; col++ )
+      owner = owners[ row * SIDE + col ] = nearestInTree( tree, col, row, owner );
+  }
+}
+
+/**
+  Where the program begins.
+
+  @return program exit status
+*/
+int main( )
+{
+  int *expect = ( int * ) malloc( SIDE * SIDE * sizeof( int ) );
+  int *got = ( int * ) malloc( SIDE * SIDE * sizeof( int ) );
+  srand( 230 );
+
+  printf( "%d x %d canvas, vector kernel: %s\n", SIDE, SIDE, scanKernel() );
+  printf( "%6s %10s %10s %10s\n", "seeds", "tree", "scalar", "vector" );
+
+  for ( int c = 0; c < SEED_COUNTS; c++ ) {
+    int n = seedCounts[ c ];
+    Seed *list = ( Seed * ) malloc( n * sizeof( Seed ) );
+    for ( int i = 0; i < n; i++ )
+      initSeed( &list[ i ], rand() % ( SIDE * 10 ) / 10.0, rand() % ( SIDE * 10 ) / 10.0 );
+
+    KDTree *tree = buildTree( list, n );
+    SeedBlock *block = buildBlock( list, n );
+
+    double start = now();
+    treeImage( tree, expect );
+    double treeTime = now() - start;
+
+    start = now();
+    for ( int row = 0; row < SIDE; row++ )
+      scanRowScalar( block, row, SIDE, got + row * SIDE );
+    double scalarTime = now() - start;
+    bool same = memcmp( expect, got, SIDE * SIDE * sizeof( int ) ) == 0;
+
+    start = now();
+    for ( int row = 0; row < SIDE; row++ )
+      scanRow( block, row, SIDE, got + row * SIDE );
+    double vectorTime = now() - start;
+    same = same && memcmp( expect, got, SIDE * SIDE * sizeof( int ) ) == 0;
+
+    double pixels = ( double ) SIDE * SIDE / 1e9;
+    printf( "%6d %10.1f %10.1f %10.1f  ns/pixel\n", n, treeTime / pixels,
+            scalarTime / pixels, vectorTime / pixels );
+
+    freeBlock( block );
+    freeTree( tree );
+    free( list );
+
+    if ( !same ) {
+      fprintf( stderr, "Owners don't match with %d seeds\n", n );
+      return MISMATCH_EXIT;
+    }
+  }
+
+  free( expect );
+  free( got );
+
+  // Exits the program successfully.
+  return 0;
+}
@@ -0,0 +1,118 @@
+/**
+    @file seed.h
+    @author Nicholas Board (ndboard)
+
+    Contains the seed struct shared by the voronoi engines, and
+    the rule that decides which seed owns a pixel.
+*/
+
+#ifndef _SEED_H_
+#define _SEED_H_
+
+#include <stdbool.h>
+#include <math.h>
+
+/** Owner reported for a pixel that is painted white. */
+#define NO_OWNER -1
+
+/** Representation for a seed point of the diagram. */
+typedef struct {
+  /** Coordinates of the seed. */
+  double x;
+  double y;
+
+  /** The pixel the seed rounds to, which is painted white. */
+  double col;
+  double row;
+
+  /** Weight of the seed, for the weighted metrics. */
+  double weight;
+} Seed;
+
+/** The best candidate found so far while searching for a pixel's owner. */
+typedef struct {
+  /** Squared distance to the closest seed seen. */
+  double dist;
+
+  /** Lowest index of a closest seed that may own the pixel, or NO_OWNER. */
+  int owner;
+} Nearest;
+
+/**
+    Fills in a seed at the given coordinates.
+
+    @param s The seed to fill in.
+    @param x The x coordinate of the seed.
+    @param y The y coordinate of the seed.
+*/
+static inline void initSeed( Seed *s, double x, double y )
+{
+  s->x = x;
+  s->y = y;
+  s->col = round( x );
+  s->row = round( y );
+  s->weight = 1;
+}
+
+/**
+    Starts a search for the owner of a pixel.
+
+    @param best The search state to reset.
+*/
+static inline void initNearest( Nearest *best )
+{
+  best->dist = INFINITY;
+  best->owner = NO_OWNER;
+}
+
+/**
+    Offers a seed as the owner of a pixel, at a distance measured
+    by any metric.  The owner is the lowest indexed seed among the
+    closest ones, skipping any seed that rounds to the pixel itself.
+    If every closest seed rounds to the pixel, the pixel has no
+    owner and is painted white.  Seeds may be offered in any order,
+    and more than once.
+
+    @param best The search state to update.
+    @param list The list of seeds.
+    @param idx Index of the seed being offered.
+    @param d The seed's distance from the pixel.
+    @param col The column of the pixel.
+    @param row The row of the pixel.
+*/
+static inline void considerDistance( Nearest *best, Seed const *list, int idx,
+                                     double d, int col, int row )
+{
+  if ( d > best->dist )
+    return;
+
+  bool white = list[ idx ].col == col && list[ idx ].row == row;
+
+  if ( d < best->dist ) {
+    best->dist = d;
+    best->owner = white ? NO_OWNER : idx;
+  }
+  else if ( !white && ( best->owner == NO_OWNER || idx < best->owner ) ) {
+    best->owner = idx;
+  }
+}
+
+/**
+    Offers a seed as the owner of a pixel by its squared Euclidean
+    distance, following the rule of considerDistance().
+
+    @param best The search state to update.
+    @param list The list of seeds.
+    @param idx Index of the seed being offered.
+    @param col The column of the pixel.
+    @param row The row of the pixel.
+*/
+static inline void considerSeed( Nearest *best, Seed const *list, int idx,
+                                 int col, int row )
+{
+  double dx = col - list[ idx ].x;
+  double dy = row - list[ idx ].y;
+  considerDistance( best, list, idx, dx * dx + dy * dy, col, row );
+}
+
+#endif
@@ -14,11 +14,12 @@ fi
 testHlight() {
   TESTNO=$1
   ESTATUS=$2
+  ARGS=$3
 
   rm -f output.txt
 
-  echo "Hlight test $TESTNO: ./hlight < input-h$TESTNO.html > output.txt"
-  ./hlight < input-h$TESTNO.html > output.txt
+  echo "Hlight test $TESTNO: ./hlight $ARGS < input-h$TESTNO.html > output.txt"
+  ./hlight $ARGS < input-h$TESTNO.html > output.txt
   STATUS=$?
 
   # Make sure the program exited with the right exit status.
@@ -47,9 +48,10 @@ testHlight() {
 testVoronoi() {
   TESTNO=$1
   ESTATUS=$2
+  ARGS=$3
 
-  # Name of the output file depends on whether this is an error test case.
-  if [ $ESTATUS -eq 0 ]
+  # Name of the output file depends on whether an image is expected.
+  if [ -f expected-v$TESTNO.ppm ]
   then
       EXPECTED="expected-v$TESTNO.ppm"
       OUTPUT="output.ppm"
@@ -60,8 +62,8 @@ testVoronoi() {
 
   rm -f "$OUTPUT"
 
-  echo "Voronoi test $TESTNO: ./voronoi < input_v$TESTNO.txt > $OUTPUT"
-  ./voronoi < input-v$TESTNO.txt > $OUTPUT
+  echo "Voronoi test $TESTNO: ./voronoi $ARGS < input-v$TESTNO.txt > $OUTPUT"
+  ./voronoi $ARGS < input-v$TESTNO.txt > $OUTPUT
   STATUS=$?
 
   # Make sure the program exited with the right exit status.
@@ -92,6 +94,12 @@ testHlight 3 0
 testHlight 4 0
 testHlight 5 101
 testHlight 6 100
+testHlight 7 0 "-j 3"
+testHlight 8 0
+testHlight 9 0 "-f html"
+testHlight 10 101 "-f plain"
+testHlight 11 0 "-e check"
+testHlight 12 0 "-e decode"
 
 # Test the voronoi program.
 testVoronoi 1 0
@@ -100,6 +108,20 @@ testVoronoi 3 0
 testVoronoi 4 0
 testVoronoi 5 100
 testVoronoi 6 100
+testVoronoi 7 0 -n
+testVoronoi 8 0 -n
+testVoronoi 9 100 -n
+testVoronoi 10 0 "-n -e"
+testVoronoi 11 0 -e
+testVoronoi 12 0 -b
+testVoronoi 13 0 "-n -w 37 -h 21"
+testVoronoi 14 0 "-n -j 3"
+testVoronoi 15 0 "-n -a"
+testVoronoi 16 0 "-n -v"
+testVoronoi 17 0 "-n -s"
+testVoronoi 18 0 "-n -p -d"
+testVoronoi 19 0 "-n -m power"
+testVoronoi 20 0 "-n -x"
 
 if [ $FAIL -ne 0 ]; then
   echo "FAILING TESTS!"
@@ -2,164 +2,629 @@
   @file voronoi.c
   @file Nicholas Board (ndboard)
 
-  This program takes in three points through commandline and
-  creates a voronoi diagram based off of them.  It pixel in the
+  This program takes in seed points through standard input and
+  creates a voronoi diagram based off of them.  Each pixel in the
   image is painted a different color based off of which of the
-  three input points is closest.
+  input points is closest.  By default it reads exactly three
+  points, with -n it reads a count followed by that many points.
+  Owners are found with a k-d tree per pixel, or with -e by a
+  distance transform that labels a whole row at a time.  The
+  image is text P3, or binary P6 with -b, written to standard
+  output or with -o straight into a mapped file.  The canvas is
+  100 by 100 unless -w and -h give another size.  Only one row is
+  held in memory at a time, so large canvases stay cheap.  With
+  -j, bands of rows are rendered on that many threads.
+
+  With -a the diagram is animated.  After the seeds, each line of
+  input moves one seed, given as its index from 0 and its new
+  coordinates, and a new frame is written for each move.  Only the
+  pixels near the moved seed are relabeled, and with -o only those
+  are repainted in the mapped file, which always holds the latest
+  frame.
+
+  With -v the image is replaced by the edges of the diagram, found
+  with Fortune's sweep and clipped to the canvas.  Each edge is
+  written as two lines holding its ends, then a blank line, which
+  is the segment format the drawing program reads its models in.
+
+  With -s the input is a stream of seed sets, each read like a
+  single one, and a diagram is written for each until the input
+  runs out.  This saves starting a process per diagram.  When the
+  stream ends, the number of diagrams, their throughput and their
+  latencies are reported on standard error.
+
+  Seeds cycle through twelve colors, or with -p each seed gets its
+  own generated color.  With -d pixels darken with their distance
+  from the seed that owns them, and with -x cell boundaries are
+  smoothed by supersampling the pixels on them.
+
+  With -m another metric can be named in place of the Euclidean
+  one: manhattan, chebyshev, or for weighted seeds additive,
+  multiplicative or power.  Weighted seeds are each given as x, y
+  and a weight, which has to be positive for multiplicative.
 */
 
 #include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
 #include<stdbool.h>
-#include<math.h>
-
-// The six doubles that store the input coordinates.
-double pointOneX = 0;
-double pointOneY = 0;
-double pointTwoX = 0;
-double pointTwoY = 0;
-double pointThreeX = 0;
-double pointThreeY = 0;
+#include<time.h>
+#include"seed.h"
+#include"kdtree.h"
+#include"ppm.h"
+#include"render.h"
+#include"anim.h"
+#include"fortune.h"
+#include"metric.h"
 
 // Controls the parameters.
 #define DIMENSIONS 100
+#define MAX_DIMENSION 65536
 #define COORDINATES 6
 #define INVALID_INPUT_EXIT 100
+#define USAGE_EXIT 1
+#define OUTPUT_EXIT 1
+#define INIT_TIMES 64
+
+// Ways of coloring the image, which can be combined.
+#define COLOR_GENERATED 1
+#define COLOR_SHADED 2
+#define COLOR_SMOOTH 4
+
+// Shading falls off over about this many cell widths.
+#define SHADE_SPAN 1.0
 
 // Prototyping functions used.
-bool nearestPoint( int, int, double, double );
-void chooseColor( int, int);
-double getDistance( double, double, double, double );
+Seed *readSeeds( bool counted, bool weighted, int *count );
+bool parseNumber( char const *str, int limit, int *value );
+int usage( void );
+int animate( Seed const *list, int count, int width, int height,
+             bool binary, int colors, char const *fname );
+int writeEdges( Seed const *list, int count, int width, int height,
+                char const *fname );
+int drawImage( Seed const *list, int count, int width, int height, int metric,
+               bool transform, bool binary, int threads, int colors,
+               char const *fname );
+int stream( bool counted, int width, int height, int metric, bool transform,
+            bool vector, bool binary, int threads, int colors );
+Palette *choosePalette( Seed const *list, int count, int width, int height,
+                        int colors );
 
 /**
   Where the program begins.
 
+  @param argc The number of command-line arguments.
+  @param argv The list of command-line arguments.
   @return program exit status
 */
-int main( )
+int main( int argc, char *argv[] )
 {
+  bool counted = false;
+  bool transform = false;
+  int metric = EUCLIDEAN;
+  bool animated = false;
+  bool vector = false;
+  bool streamed = false;
+  int colors = 0;
+  bool binary = false;
+  char const *fname = NULL;
+  int width = DIMENSIONS;
+  int height = DIMENSIONS;
+  int threads = 1;
 
-  /**
-    Takes in the coordinates.  The int count keeps track
-    of the amount of doubles successfully read in.  The if
-    statement will make sure six are read in, and gives an
-    error message if not.
-  */
-  int count = scanf( "%lf%lf%lf", &pointOneX, &pointOneY, &pointTwoX );
-  count += scanf( "%lf%lf%lf", &pointTwoY, &pointThreeX, &pointThreeY );
+  for ( int i = 1; i < argc; i++ ) {
+    if ( strcmp( argv[ i ], "-n" ) == 0 ) {
+      counted = true;
+    } else if ( strcmp( argv[ i ], "-e" ) == 0 ) {
+      transform = true;
+    } else if ( strcmp( argv[ i ], "-a" ) == 0 ) {
+      animated = true;
+    } else if ( strcmp( argv[ i ], "-v" ) == 0 ) {
+      vector = true;
+    } else if ( strcmp( argv[ i ], "-s" ) == 0 ) {
+      streamed = true;
+    } else if ( strcmp( argv[ i ], "-m" ) == 0 && i + 1 < argc &&
+                ( metric = metricNamed( argv[ i + 1 ] ) ) >= 0 ) {
+      i++;
+    } else if ( strcmp( argv[ i ], "-p" ) == 0 ) {
+      colors |= COLOR_GENERATED;
+    } else if ( strcmp( argv[ i ], "-d" ) == 0 ) {
+      colors |= COLOR_SHADED;
+    } else if ( strcmp( argv[ i ], "-x" ) == 0 ) {
+      colors |= COLOR_SMOOTH;
+    } else if ( strcmp( argv[ i ], "-b" ) == 0 ) {
+      binary = true;
+    } else if ( strcmp( argv[ i ], "-o" ) == 0 && i + 1 < argc ) {
+      fname = argv[ ++i ];
+    } else if ( strcmp( argv[ i ], "-w" ) == 0 && i + 1 < argc &&
+                parseNumber( argv[ i + 1 ], MAX_DIMENSION, &width ) ) {
+      i++;
+    } else if ( strcmp( argv[ i ], "-h" ) == 0 && i + 1 < argc &&
+                parseNumber( argv[ i + 1 ], MAX_DIMENSION, &height ) ) {
+      i++;
+    } else if ( strcmp( argv[ i ], "-j" ) == 0 && i + 1 < argc &&
+                parseNumber( argv[ i + 1 ], MAX_THREADS, &threads ) ) {
+      i++;
+    } else {
+      return usage();
+    }
+  }
+
+  // A stream of diagrams can't be animated, or all go in one file.
+  if ( streamed && ( animated || fname ) )
+    return usage();
+
+  // The other engines only know the Euclidean metric, and only
+  // whole images are smoothed.
+  if ( metric != EUCLIDEAN && ( transform || animated || vector ) )
+    return usage();
+  if ( ( colors & COLOR_SMOOTH ) && ( animated || vector ) )
+    return usage();
 
-  if ( count != COORDINATES ) {
+  if ( streamed )
+    return stream( counted, width, height, metric, transform, vector, binary, threads,
+                   colors );
+
+  // Takes in the seeds, giving an error message if they're malformed.
+  int count;
+  Seed *list = readSeeds( counted, isWeighted( metric ), &count );
+
+  if ( list == NULL || !validWeights( metric, list, count ) ) {
+    free( list );
     printf("Invalid input\n");
     return INVALID_INPUT_EXIT;
   }
 
-  // Prints the header information for the .ppm filetype.
-  printf( "P3\n%d %d\n255\n", DIMENSIONS, DIMENSIONS );
+  if ( vector ) {
+    int status = writeEdges( list, count, width, height, fname );
+    free( list );
+    return status;
+  }
+
+  if ( animated ) {
+    int status = animate( list, count, width, height, binary, colors, fname );
+    free( list );
+    return status;
+  }
 
-  /**
-    Loops through DIMENSIONS^2 times, calling chooseColor
-    on eaach pixel and switches printing to a new line
-    after every DIMENSIONS amount.
-  */
-  for ( int i = 0; i < DIMENSIONS; i++ ) {
-    for ( int j = 0; j < DIMENSIONS; j++ ) {
+  int status = drawImage( list, count, width, height, metric, transform, binary, threads,
+                          colors, fname );
+  free( list );
 
-      chooseColor( j, i );
-    }
+  // Exits the program with the status of the drawing.
+  return status;
+}
+
+/**
+  Draws the diagram as an image.
+
+  @param list The seeds.
+  @param count The number of seeds.
+  @param width The width of the canvas.
+  @param height The height of the canvas.
+  @param metric The metric to measure distance with.
+  @param transform True to label rows with the distance transform.
+  @param binary True to write P6, false to write P3.
+  @param threads The number of threads to render with.
+  @param colors How to color the image.
+  @param fname The file to map, or NULL for standard output.
+  @return program exit status
+*/
+int drawImage( Seed const *list, int count, int width, int height, int metric,
+               bool transform, bool binary, int threads, int colors,
+               char const *fname )
+{
+  KDTree *tree = buildTree( list, count );
+  Metric *m = tree && metric != EUCLIDEAN ? buildMetric( tree, metric ) : NULL;
+  Palette *pal = choosePalette( list, count, width, height, colors );
+
+  // Writes the header information for the .ppm filetype.
+  Image *img = tree && pal && ( m || metric == EUCLIDEAN ) ?
+               openImage( width, height, binary, pal, fname ) : NULL;
+  if ( img == NULL ) {
+    if ( m )
+      freeMetric( m );
+    if ( tree )
+      freeTree( tree );
+    if ( pal )
+      freePalette( pal );
+    fprintf( stderr, "Can't open output file\n" );
+    return OUTPUT_EXIT;
+  }
+
+  // Finds the owner of each pixel and paints the rows.
+  bool rendered = renderImage( tree, m, transform, colors & COLOR_SMOOTH, img, threads );
+  bool written = closeImage( img ) && rendered;
+  if ( m )
+    freeMetric( m );
+  freeTree( tree );
+  freePalette( pal );
 
-    printf( "\n" );
+  if ( !written ) {
+    fprintf( stderr, "Can't write output file\n" );
+    return OUTPUT_EXIT;
   }
 
-  // Exits the program successfully.
   return 0;
 }
 
 /**
-  Determines if the given point is the closest one to the given pixel.
+  Builds the palette for a diagram.  Shading falls off over about
+  the width of an average cell.
 
-  @param col The column of the given pixel.
-  @param row The two of the given pixel.
-  @param x The x coordinate of the given white point.
-  @param y The y coordinate of the given white point.
-  @return 1 if the given point is closest to the given pixel.
-  @return 0 if the given point is not the closest to the given pixel.
+  @param list The seeds.
+  @param count The number of seeds.
+  @param width The width of the canvas.
+  @param height The height of the canvas.
+  @param colors How to color the image.
+  @return The palette, or NULL if it can't be allocated.
 */
-bool nearestPoint( int col, int row, double x, double y )
+Palette *choosePalette( Seed const *list, int count, int width, int height,
+                        int colors )
 {
+  Palette *pal = buildPalette( count, colors & COLOR_GENERATED );
 
-  //test for white point
-  int testX = round( x );
-  int testY = round( y );
-
-  if ( testX == col && testY == row ) {
-    return 0;
+  if ( pal && ( colors & COLOR_SHADED ) ) {
+    pal->shade = list;
+    pal->falloff = SHADE_SPAN * sqrt( ( double ) width * height / count );
   }
 
-  // The distances between the given pixel and each white point.
-  double a = getDistance( col, row, pointOneX, pointOneY );
-  double b = getDistance( col, row, pointTwoX, pointTwoY );
-  double c = getDistance( col, row, pointThreeX, pointThreeY );
+  return pal;
+}
 
-  // Determines the smallest of the distances.
-  double smallest = a;
+/**
+  Prints how to run the program.
 
-  if ( b < smallest ) {
-    smallest = b;
-  }
+  @return The exit status for bad arguments.
+*/
+int usage( void )
+{
+  fprintf( stderr, "usage: voronoi [-n] [-e] [-a] [-v] [-s] [-m <metric>] [-p] [-d] [-x] [-b] "
+           "[-o <file>] [-w <width>] [-h <height>] [-j <threads>]\n" );
+  return USAGE_EXIT;
+}
+
+/**
+  Reads the seeds from standard input.  Either exactly three
+  seeds are read, or a count followed by that many seeds.
+
+  @param counted True if the input starts with the number of seeds.
+  @param weighted True if each seed is followed by its weight.
+  @param count Set to the number of seeds read.
+  @return The list of seeds, or NULL if the input is invalid.
+*/
+Seed *readSeeds( bool counted, bool weighted, int *count )
+{
+  int n = COORDINATES / 2;
 
-  if ( c < smallest ) {
-    smallest = c;
+  if ( counted && ( scanf( "%d", &n ) != 1 || n < 1 ) )
+    return NULL;
+
+  Seed *list = ( Seed * ) malloc( n * sizeof( Seed ) );
+  if ( list == NULL )
+    return NULL;
+
+  for ( int i = 0; i < n; i++ ) {
+    double x, y;
+    if ( scanf( "%lf%lf", &x, &y ) != 2 ) {
+      free( list );
+      return NULL;
+    }
+
+    initSeed( &list[ i ], x, y );
+    if ( weighted && scanf( "%lf", &list[ i ].weight ) != 1 ) {
+      free( list );
+      return NULL;
+    }
   }
 
-  // The distance between the given pixel and the given white point.
-  double d = getDistance( col, row, x, y );
-  
-  // If the closest white point was given, then 1 is returned.
-  if ( smallest == d ) {
-    return 1;
+  *count = n;
+  return list;
+}
+
+/**
+  Parses a positive number from a command-line argument.
+
+  @param str The argument to parse.
+  @param limit The largest number allowed.
+  @param value Set to the number if it's valid.
+  @return True if the argument is a whole number from 1 to limit.
+*/
+bool parseNumber( char const *str, int limit, int *value )
+{
+  char *end;
+  long v = strtol( str, &end, 10 );
+
+  if ( end == str || *end != '\0' || v < 1 || v > limit )
+    return false;
+
+  *value = v;
+  return true;
+}
+
+/**
+  Writes the current frame of an animation to standard output.
+
+  @param a The animation.
+  @param binary True to write P6, false to write P3.
+  @param pal The colors to paint with.
+  @return True if the frame was written.
+*/
+static bool writeFrame( Animation const *a, bool binary, Palette const *pal )
+{
+  Image *img = openImage( a->width, a->height, binary, pal, NULL );
+  if ( img == NULL )
+    return false;
+
+  for ( int i = 0; i < a->height; i++ ) {
+    paintRow( img, a->labels + ( long ) i * a->width, i, rowOf( img, i ) );
+    finishRow( img, i );
   }
 
-  // If the closest white point was not given, then 0 is returned.
-  return 0;
+  return closeImage( img );
+}
+
+/**
+  Repaints the tiles relabeled by the last move in a mapped image.
+
+  @param a The animation.
+  @param img The mapped image.
+*/
+static void repaintTouched( Animation const *a, Image *img )
+{
+  for ( int i = 0; i < a->touchedCount; i++ ) {
+    int t = a->touched[ i ];
+    int c0 = t % a->tilesWide * TILE;
+    int r0 = t / a->tilesWide * TILE;
+    int c1 = c0 + TILE < a->width ? c0 + TILE : a->width;
+    int r1 = r0 + TILE < a->height ? r0 + TILE : a->height;
+
+    for ( int row = r0; row < r1; row++ )
+      paintSpan( img, a->labels + ( long ) row * a->width, row, c0, c1, rowOf( img, row ) );
+  }
 }
 
 /**
-  Checks each white point to see if it is the closest, and it is
-  painted the appropriate color.  If it is matched with none then
-  it is painted white.
+  Animates the diagram, reading moves from standard input and
+  writing a frame after each one.
 
-  @param col The column of the current pixel.
-  @param row The row of the current pixel.
+  @param list The starting seeds.
+  @param count The number of seeds.
+  @param width The width of the canvas.
+  @param height The height of the canvas.
+  @param binary True to write P6, false to write P3.
+  @param colors How to color the image.
+  @param fname The file to map, or NULL to write frames to standard output.
+  @return program exit status
 */
-void chooseColor( int col, int row )
+int animate( Seed const *list, int count, int width, int height,
+             bool binary, int colors, char const *fname )
 {
+  Animation *a = startAnimation( list, count, width, height );
+  Palette *pal = a ? choosePalette( a->list, count, width, height, colors ) : NULL;
+  Image *img = fname && pal ? openImage( width, height, binary, pal, fname ) : NULL;
+  if ( pal == NULL || ( fname && img == NULL ) ) {
+    if ( a )
+      freeAnimation( a );
+    if ( pal )
+      freePalette( pal );
+    fprintf( stderr, "Can't open output file\n" );
+    return OUTPUT_EXIT;
+  }
+
+  // The first frame has every pixel painted.
+  bool ok = true;
+  if ( img ) {
+    for ( int i = 0; i < height; i++ )
+      paintRow( img, a->labels + ( long ) i * width, i, rowOf( img, i ) );
+  } else {
+    ok = writeFrame( a, binary, pal );
+  }
+
+  int k;
+  double x, y;
+  int matched;
+  while ( ok && ( matched = scanf( "%d%lf%lf", &k, &x, &y ) ) == 3 && k >= 0 && k < count ) {
+    moveSeed( a, k, x, y );
+
+    if ( img )
+      repaintTouched( a, img );
+    else
+      ok = writeFrame( a, binary, pal );
+  }
 
-  // Paints the pixel red if it is closest to the first point.
-  if ( nearestPoint( col, row, pointOneX, pointOneY ) == 1 ) {
-    printf( "255   0   0 " );
+  int status = 0;
+  if ( ok && matched != EOF ) {
+    printf( "Invalid input\n" );
+    status = INVALID_INPUT_EXIT;
   }
-  // Paints the pixel green if it is closest to the second point.
-  else if ( nearestPoint( col, row,  pointTwoX, pointTwoY ) == 1) {
-    printf( "  0 255   0 " );
+
+  if ( img )
+    ok = closeImage( img ) && ok;
+  freePalette( pal );
+  freeAnimation( a );
+
+  if ( !ok ) {
+    fprintf( stderr, "Can't write output file\n" );
+    return OUTPUT_EXIT;
   }
-  // Paints the pixel blue if it is closest to the third point.
-  else if ( nearestPoint( col, row, pointThreeX, pointThreeY ) == 1) {
-    printf( "  0   0 255 " );
+
+  return status;
+}
+
+/**
+  Gets a coordinate ready to print to three places, so one that
+  rounds to zero isn't printed as -0.000.
+
+  @param v The coordinate.
+  @return The coordinate, or zero if it rounds to zero.
+*/
+static double printable( double v )
+{
+  return v > -0.0005 && v < 0.0005 ? 0 : v;
+}
+
+/**
+  Writes the edges of the diagram, clipped to the canvas.  The
+  canvas covers every pixel, so it runs half a pixel past the
+  centers of the outer ones.
+
+  @param list The seeds.
+  @param count The number of seeds.
+  @param width The width of the canvas.
+  @param height The height of the canvas.
+  @param fname The file to write, or NULL for standard output.
+  @return program exit status
+*/
+int writeEdges( Seed const *list, int count, int width, int height,
+                char const *fname )
+{
+  FILE *fp = fname ? fopen( fname, "w" ) : stdout;
+  if ( fp == NULL ) {
+    fprintf( stderr, "Can't open output file\n" );
+    return OUTPUT_EXIT;
   }
-  // Paints the pixel white if it is a given point.
-  else {
-    printf( "255 255 255 " );
+
+  Segment *segs;
+  int n = sweepEdges( list, count, -0.5, -0.5, width - 0.5, height - 0.5, &segs );
+
+  for ( int i = 0; i < n; i++ )
+    fprintf( fp, "%.3f %.3f\n%.3f %.3f\n\n", printable( segs[ i ].x1 ),
+             printable( segs[ i ].y1 ), printable( segs[ i ].x2 ), printable( segs[ i ].y2 ) );
+  free( segs );
+
+  bool ok = n >= 0 && !ferror( fp );
+  if ( fname )
+    ok = fclose( fp ) == 0 && ok;
+  else
+    ok = fflush( fp ) == 0 && ok;
+
+  if ( !ok ) {
+    fprintf( stderr, "Can't write output file\n" );
+    return OUTPUT_EXIT;
   }
+
+  return 0;
+}
+
+/**
+  Gets the time from a clock that only moves forward.
+
+  @return The time in seconds.
+*/
+static double now( void )
+{
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+  Orders two latencies for sorting.
+
+  @param a Pointer to the first latency.
+  @param b Pointer to the second latency.
+  @return Negative, zero or positive like strcmp.
+*/
+static int compareTimes( void const *a, void const *b )
+{
+  double x = *( double const * ) a;
+  double y = *( double const * ) b;
+  return x < y ? -1 : x > y;
+}
+
+/**
+  Reports how fast a stream of diagrams was drawn.
+
+  @param drawn The number of diagrams.
+  @param times The latencies recorded, which get sorted.
+  @param n The number of latencies, fewer than drawn if there wasn't
+           room for them all.
+  @param elapsed The seconds the whole stream took.
+*/
+static void reportStream( int drawn, double *times, int n, double elapsed )
+{
+  if ( n > 0 )
+    qsort( times, n, sizeof( double ), compareTimes );
+
+  double total = 0;
+  for ( int i = 0; i < n; i++ )
+    total += times[ i ];
+
+  fprintf( stderr, "%d diagrams in %.3f s, %.1f diagrams/s\n", drawn, elapsed,
+           elapsed > 0 ? drawn / elapsed : 0 );
+  if ( n > 0 )
+    fprintf( stderr, "latency ms: mean %.3f, p50 %.3f, p99 %.3f, max %.3f\n",
+             total / n * 1e3, times[ n / 2 ] * 1e3,
+             times[ ( int ) ( ( n - 1 ) * 0.99 ) ] * 1e3, times[ n - 1 ] * 1e3 );
 }
 
 /**
-  Determines the distance between two points given.
+  Draws a diagram for each seed set in a stream on standard input,
+  writing them one after another to standard output.
 
-  @param x1 The x coordinate of the first point.
-  @param y1 The x coordinate of the first point.
-  @param x2 The x coordinate of the second point.
-  @param y2 The x coordinate of the second point.
+  @param counted True if each seed set starts with its number of seeds.
+  @param width The width of the canvas.
+  @param height The height of the canvas.
+  @param metric The metric to measure distance with.
+  @param transform True to label rows with the distance transform.
+  @param vector True to write edges instead of images.
+  @param binary True to write P6, false to write P3.
+  @param threads The number of threads to render with.
+  @param colors How to color the image.
+  @return program exit status
 */
-double getDistance( double x1, double y1, double x2, double y2)
+int stream( bool counted, int width, int height, int metric, bool transform,
+            bool vector, bool binary, int threads, int colors )
 {
-  return sqrt( ( ( x1 - x2 ) * ( x1 - x2 ) ) + ( ( y1 - y2 ) * ( y1 - y2 ) ) );
+  // Latencies are only for the report, so if there's no room for
+  // more of them, the rest just go unrecorded.
+  int cap = INIT_TIMES;
+  int n = 0;
+  double *times = ( double * ) malloc( cap * sizeof( double ) );
+  bool recording = times != NULL;
+  int drawn = 0;
+
+  double start = now();
+  int status = 0;
+  int ch;
+
+  // The stream ends cleanly when nothing but space is left.
+  while ( status == 0 && scanf( " " ) != EOF && ( ch = getchar() ) != EOF ) {
+    ungetc( ch, stdin );
+
+    double began = now();
+    int count;
+    Seed *list = readSeeds( counted, isWeighted( metric ), &count );
+    if ( list == NULL || !validWeights( metric, list, count ) ) {
+      free( list );
+      printf( "Invalid input\n" );
+      status = INVALID_INPUT_EXIT;
+      break;
+    }
+
+    if ( vector )
+      status = writeEdges( list, count, width, height, NULL );
+    else
+      status = drawImage( list, count, width, height, metric, transform, binary, threads,
+                          colors, NULL );
+    free( list );
+    drawn++;
+
+    if ( recording && n >= cap ) {
+      double *grown = ( double * ) realloc( times, 2 * cap * sizeof( double ) );
+      if ( grown == NULL ) {
+        recording = false;
+      } else {
+        times = grown;
+        cap *= 2;
+      }
+    }
+    if ( recording )
+      times[ n++ ] = now() - began;
+  }
+
+  reportStream( drawn, times, n, now() - start );
+  free( times );
+  return status;
 }
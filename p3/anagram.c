@@ -0,0 +1,126 @@
+/**
+    @file anagram.c
+    @author Nicholas Board (ndboard)
+
+    Builds and searches the anagram index.  The table uses linear
+    probing and is kept at most half full.  The words of each group
+    are placed by going through the dictionary in order, so they stay
+    in that order without sorting.
+*/
+
+#include <stdlib.h>
+#include "anagram.h"
+
+/** Number of letters in the alphabet. */
+#define LETTERS 26
+
+/**
+    Mixes a key so every bit of it affects the slot it goes in.
+
+    @param key The key.
+    @return The hash of the key.
+*/
+static unsigned hashKey( LetterKey key )
+{
+  key ^= key >> 31;
+  key *= 0x7fb5d329728ea185ULL;
+  key ^= key >> 27;
+  key *= 0x81dadef4bc2dd44dULL;
+  key ^= key >> 33;
+  return ( unsigned ) key;
+}
+
+/**
+    Finds the slot for a key, either the one with the key or the empty
+    one it would go in.
+
+    @param index The index to search.
+    @param key The key to look for.
+    @return The slot.
+*/
+static AnagramSlot *findSlot( AnagramIndex const *index, LetterKey key )
+{
+  unsigned mask = index->slotCount - 1;
+  unsigned i = hashKey( key ) & mask;
+  while ( index->slots[ i ].count > 0 && index->slots[ i ].key != key )
+    i = ( i + 1 ) & mask;
+  return &index->slots[ i ];
+}
+
+LetterKey letterKey( char const *letters )
+{
+  // Count the letters, then write a 1 for each, with a 0 after every
+  // letter but the last.
+  int counts[ LETTERS ] = { 0 };
+  for ( int i = 0; letters[ i ]; i++ )
+    counts[ letters[ i ] - 'a' ]++;
+
+  LetterKey key = 0;
+  for ( int c = 0; c < LETTERS; c++ ) {
+    for ( int i = 0; i < counts[ c ]; i++ )
+      key = key << 1 | 1;
+    if ( c < LETTERS - 1 )
+      key <<= 1;
+  }
+
+  return key;
+}
+
+bool buildAnagrams( AnagramIndex *index, LetterKey const *keys, unsigned count )
+{
+  index->slotCount = 2;
+  while ( index->slotCount < 2 * count )
+    index->slotCount *= 2;
+  index->wordCount = count;
+  index->slots = ( AnagramSlot * ) calloc( index->slotCount, sizeof( AnagramSlot ) );
+  index->words = ( unsigned * ) malloc( ( count > 0 ? count : 1 ) * sizeof( unsigned ) );
+  if ( index->slots == NULL || index->words == NULL ) {
+    freeAnagrams( index );
+    return false;
+  }
+
+  // Count the words in each group.
+  for ( unsigned i = 0; i < count; i++ ) {
+    AnagramSlot *slot = findSlot( index, keys[ i ] );
+    slot->key = keys[ i ];
+    slot->count++;
+  }
+
+  // Give each group its place in the list, and count the words in it
+  // again as they're placed.
+  unsigned first = 0;
+  for ( unsigned i = 0; i < index->slotCount; i++ ) {
+    index->slots[ i ].first = first;
+    first += index->slots[ i ].count;
+  }
+  for ( unsigned i = 0; i < count; i++ ) {
+    AnagramSlot *slot = findSlot( index, keys[ i ] );
+    index->words[ slot->first++ ] = i;
+  }
+  for ( unsigned i = 0; i < index->slotCount; i++ )
+    index->slots[ i ].first -= index->slots[ i ].count;
+
+  return true;
+}
+
+void freeAnagrams( AnagramIndex *index )
+{
+  free( index->slots );
+  free( index->words );
+  index->slots = NULL;
+  index->words = NULL;
+}
+
+unsigned const *findAnagrams( AnagramIndex const *index, LetterKey key, unsigned *count )
+{
+  AnagramSlot const *slot = findSlot( index, key );
+
+  // A group that runs off the end of the list can only come from a
+  // damaged index file, so it's taken to have no words.
+  if ( slot->first > index->wordCount || slot->count > index->wordCount - slot->first ) {
+    *count = 0;
+    return index->words;
+  }
+  *count = slot->count;
+  return index->words + slot->first;
+}
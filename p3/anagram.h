@@ -0,0 +1,83 @@
+/**
+    @file anagram.h
+    @author Nicholas Board (ndboard)
+
+    Contains the index jumble finds anagrams with.  Words are grouped
+    by the letters they use, and each group is found by hashing its
+    letters, so a query is one lookup instead of a pass over every
+    word.
+*/
+
+#ifndef _ANAGRAM_H_
+#define _ANAGRAM_H_
+
+#include <stdbool.h>
+
+/**
+    The letters of a word, ignoring their order.  With the letters
+    sorted, each one is a 1 bit, and there's a 0 bit between each
+    letter of the alphabet and the next, so a word of up to 39
+    letters fits, and words with the same letters are the only ones
+    with the same key.
+*/
+typedef unsigned long long LetterKey;
+
+/** A group of words with the same letters, or an empty slot. */
+typedef struct {
+  /** The letters of the group. */
+  LetterKey key;
+
+  /** Where the group starts in the list of words, and how many
+      words are in it.  Empty slots have no words. */
+  unsigned first;
+  unsigned count;
+} AnagramSlot;
+
+/** A hash table of the groups of a dictionary. */
+typedef struct {
+  /** The table, a power of two in size. */
+  AnagramSlot *slots;
+  unsigned slotCount;
+
+  /** Number of words, and their numbers in the dictionary, a group
+      at a time.  Each group is in the order of the dictionary. */
+  unsigned wordCount;
+  unsigned *words;
+} AnagramIndex;
+
+/**
+    Finds the key of some letters, counting each one.
+
+    @param letters The letters, all lowercase.
+    @return The key.
+*/
+LetterKey letterKey( char const *letters );
+
+/**
+    Builds the index for a dictionary, given the key of each word.
+
+    @param index The index to fill in.
+    @param keys The key of each word, in the order of the dictionary.
+    @param count The number of words.
+    @return True, or false if the index can't be allocated.
+*/
+bool buildAnagrams( AnagramIndex *index, LetterKey const *keys, unsigned count );
+
+/**
+    Frees an index's allocated space.
+
+    @param index The index to free.
+*/
+void freeAnagrams( AnagramIndex *index );
+
+/**
+    Finds the words with the given letters.
+
+    @param index The index to search.
+    @param key The key of the letters.
+    @param count Filled with the number of words found.
+    @return The numbers of the words, in the order of the dictionary.
+*/
+unsigned const *findAnagrams( AnagramIndex const *index, LetterKey key, unsigned *count );
+
+#endif
@@ -0,0 +1,420 @@
+/**
+    @file dawg.c
+    @author Nicholas Board (ndboard)
+
+    Builds and searches word graphs.  The graph is built in one pass
+    over the words in sorted order.  Only the path of the last word
+    is kept as a trie; when a word leaves part of it behind, that part
+    can't change any more, so its nodes are finished from the bottom
+    up, each one merged with an identical node already in the graph
+    if there is one.  Identical nodes are found with a hash table of
+    the finished ones.
+
+    The searches are walks down from the root like the trie's, with
+    the place of the first word below each node worked out on the way
+    from the counts of the words before it.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "dawg.h"
+
+/** Number of letters in the alphabet. */
+#define LETTERS 26
+
+/** Longest word a graph can hold, so lengths fit in a byte. */
+#define MAX_LENGTH 254
+
+/** Shortest finish for a node with no words below it. */
+#define NO_WORDS 255
+
+/** Marks an empty slot of the table of finished nodes. */
+#define EMPTY_SLOT 0xFFFFFFFFu
+
+/** A node on the path of the last word, not finished yet. */
+typedef struct {
+  /** The edges so far.  The last one goes to the next node on the
+      path, until that one is finished. */
+  DawgEdge edges[ LETTERS ];
+  int edgeCount;
+
+  /** How many times the path here is a word. */
+  unsigned repeats;
+} Pending;
+
+/** A graph being built. */
+typedef struct {
+  /** The graph, and room for its nodes and edges. */
+  Dawg *g;
+  unsigned nodeCapacity;
+  unsigned edgeCapacity;
+
+  /** The finished nodes, by their hash, and room for them. */
+  unsigned *table;
+  unsigned tableSize;
+
+  /** True if something couldn't be allocated. */
+  bool failed;
+} Builder;
+
+/** What a walk is looking for, and what it has found. */
+typedef struct {
+  /** The graph being searched. */
+  Dawg const *g;
+
+  /** How many of each letter are left, and how many blanks. */
+  int counts[ LETTERS ];
+  int blanks;
+
+  /** True if every letter has to be used. */
+  bool exact;
+
+  /** The places of the words found so far, and how many. */
+  unsigned *found;
+  unsigned count;
+} Walk;
+
+/**
+    Hashes the contents of a node.
+
+    @param repeats How many times the node is a word.
+    @param edges The node's edges.
+    @param edgeCount The number of edges.
+    @return The hash.
+*/
+static unsigned hashNode( unsigned repeats, DawgEdge const *edges, int edgeCount )
+{
+  unsigned h = 2166136261u ^ repeats;
+  for ( int i = 0; i < edgeCount; i++ )
+    h = ( h ^ edges[ i ] ) * 16777619u;
+  h ^= h >> 15;
+  return h * 0x2c1b3c6du;
+}
+
+/**
+    Finds the slot of the table for a node, either the one holding an
+    identical finished node or the empty one it would go in.
+
+    @param b The builder.
+    @param repeats How many times the node is a word.
+    @param edges The node's edges.
+    @param edgeCount The number of edges.
+    @return The slot.
+*/
+static unsigned *findNode( Builder *b, unsigned repeats, DawgEdge const *edges, int edgeCount )
+{
+  unsigned mask = b->tableSize - 1;
+  unsigned i = hashNode( repeats, edges, edgeCount ) & mask;
+  while ( b->table[ i ] != EMPTY_SLOT ) {
+    DawgNode const *n = &b->g->nodes[ b->table[ i ] ];
+    if ( n->repeats == repeats && n->edgeCount == edgeCount &&
+         memcmp( b->g->edges + n->edges, edges, edgeCount * sizeof( DawgEdge ) ) == 0 )
+      break;
+    i = ( i + 1 ) & mask;
+  }
+  return &b->table[ i ];
+}
+
+/**
+    Doubles the table of finished nodes, putting each one in its slot
+    again.
+
+    @param b The builder.
+    @return True, or false if it can't be allocated.
+*/
+static bool growTable( Builder *b )
+{
+  unsigned *old = b->table;
+  unsigned oldSize = b->tableSize;
+  b->tableSize *= 2;
+  b->table = ( unsigned * ) malloc( b->tableSize * sizeof( unsigned ) );
+  if ( b->table == NULL ) {
+    b->table = old;
+    b->tableSize = oldSize;
+    return false;
+  }
+
+  memset( b->table, 0xFF, b->tableSize * sizeof( unsigned ) );
+  for ( unsigned i = 0; i < oldSize; i++ )
+    if ( old[ i ] != EMPTY_SLOT ) {
+      DawgNode const *n = &b->g->nodes[ old[ i ] ];
+      *findNode( b, n->repeats, b->g->edges + n->edges, n->edgeCount ) = old[ i ];
+    }
+  free( old );
+  return true;
+}
+
+/**
+    Finishes a node, giving the number of an identical node already
+    in the graph, or adding it.
+
+    @param b The builder.
+    @param p The node.
+    @return The number of the node in the graph.
+*/
+static unsigned finishNode( Builder *b, Pending const *p )
+{
+  if ( b->failed )
+    return 0;
+
+  unsigned *slot = findNode( b, p->repeats, p->edges, p->edgeCount );
+  if ( *slot != EMPTY_SLOT )
+    return *slot;
+
+  // Make room for a new node and its edges.
+  Dawg *g = b->g;
+  if ( g->nodeCount == b->nodeCapacity ) {
+    DawgNode *nodes = NULL;
+    if ( b->nodeCapacity < MAX_NODES / 2 )
+      nodes = ( DawgNode * ) realloc( g->nodes, 2 * b->nodeCapacity * sizeof( DawgNode ) );
+    if ( nodes == NULL ) {
+      b->failed = true;
+      return 0;
+    }
+    g->nodes = nodes;
+    b->nodeCapacity *= 2;
+  }
+  if ( g->edgeCount + p->edgeCount > b->edgeCapacity ) {
+    DawgEdge *edges = ( DawgEdge * ) realloc( g->edges,
+                                              2 * b->edgeCapacity * sizeof( DawgEdge ) );
+    if ( edges == NULL ) {
+      b->failed = true;
+      return 0;
+    }
+    g->edges = edges;
+    b->edgeCapacity *= 2;
+  }
+
+  // Count the words below it, and how far away they are.
+  DawgNode n = { g->edgeCount, p->repeats, p->repeats, p->edgeCount,
+                 p->repeats > 0 ? 0 : NO_WORDS, 0 };
+  for ( int i = 0; i < p->edgeCount; i++ ) {
+    DawgNode const *child = &g->nodes[ p->edges[ i ] >> EDGE_LETTER_BITS ];
+    n.words += child->words;
+    if ( child->shortest + 1 < n.shortest )
+      n.shortest = child->shortest + 1;
+    if ( child->longest + 1 > n.longest )
+      n.longest = child->longest + 1;
+  }
+
+  memcpy( g->edges + g->edgeCount, p->edges, p->edgeCount * sizeof( DawgEdge ) );
+  g->edgeCount += p->edgeCount;
+  g->nodes[ g->nodeCount ] = n;
+  *slot = g->nodeCount++;
+
+  // Keep the table at most half full.
+  if ( 2 * g->nodeCount > b->tableSize && !growTable( b ) )
+    b->failed = true;
+  return *slot;
+}
+
+/**
+    Adds the places of a range of words to what a walk has found.
+
+    @param w The walk.
+    @param first The place of the first word.
+    @param count The number of words.
+*/
+static void addRange( Walk *w, unsigned first, unsigned count )
+{
+  for ( unsigned i = 0; i < count; i++ )
+    w->found[ w->count++ ] = first + i;
+}
+
+/**
+    Collects the words below a node that can be built from the letters
+    left.
+
+    @param w The walk.
+    @param node The node.
+    @param first The place of the first word below the node.
+    @param left The number of letters left, counting blanks.
+*/
+static void walkLetters( Walk *w, unsigned node, unsigned first, int left )
+{
+  DawgNode const *n = &w->g->nodes[ node ];
+  if ( n->shortest > left || ( w->exact && n->longest < left ) )
+    return;
+
+  if ( !w->exact || left == 0 )
+    addRange( w, first, n->repeats );
+
+  // A letter of its own is never worse than a blank, so a blank is
+  // only used when the letter has run out.
+  first += n->repeats;
+  for ( unsigned i = 0; i < n->edgeCount; i++ ) {
+    DawgEdge e = w->g->edges[ n->edges + i ];
+    unsigned child = e >> EDGE_LETTER_BITS;
+    int c = e & ( ( 1 << EDGE_LETTER_BITS ) - 1 );
+    if ( w->counts[ c ] > 0 ) {
+      w->counts[ c ]--;
+      walkLetters( w, child, first, left - 1 );
+      w->counts[ c ]++;
+    } else if ( w->blanks > 0 ) {
+      w->blanks--;
+      walkLetters( w, child, first, left - 1 );
+      w->blanks++;
+    }
+    first += w->g->nodes[ child ].words;
+  }
+}
+
+/**
+    Collects the words below a node that match the rest of a pattern.
+
+    @param w The walk.
+    @param node The node.
+    @param first The place of the first word below the node.
+    @param pattern The rest of the pattern.
+    @param left The number of letters in the rest, not counting
+                ANY_ENDING.
+    @param open True if the pattern ends in ANY_ENDING.
+*/
+static void walkPattern( Walk *w, unsigned node, unsigned first, char const *pattern,
+                         int left, bool open )
+{
+  DawgNode const *n = &w->g->nodes[ node ];
+  if ( n->longest < left || ( !open && n->shortest > left ) )
+    return;
+
+  // Every word below a node matches an open pattern that's used up,
+  // and they're all in a row.
+  if ( left == 0 ) {
+    addRange( w, first, open ? n->words : n->repeats );
+    return;
+  }
+
+  first += n->repeats;
+  for ( unsigned i = 0; i < n->edgeCount; i++ ) {
+    DawgEdge e = w->g->edges[ n->edges + i ];
+    unsigned child = e >> EDGE_LETTER_BITS;
+    int c = e & ( ( 1 << EDGE_LETTER_BITS ) - 1 );
+    if ( *pattern == BLANK || *pattern - 'a' == c )
+      walkPattern( w, child, first, pattern + 1, left - 1, open );
+    first += w->g->nodes[ child ].words;
+  }
+}
+
+bool buildDawg( Dawg *g, char const *pool, unsigned const *offsets,
+                unsigned const *sorted, unsigned count )
+{
+  Builder b = { g, 1024, 4096, NULL, 2048, false };
+  g->nodes = ( DawgNode * ) malloc( b.nodeCapacity * sizeof( DawgNode ) );
+  g->edges = ( DawgEdge * ) malloc( b.edgeCapacity * sizeof( DawgEdge ) );
+  g->nodeCount = 0;
+  g->edgeCount = 0;
+  b.table = ( unsigned * ) malloc( b.tableSize * sizeof( unsigned ) );
+  Pending *path = ( Pending * ) malloc( ( MAX_LENGTH + 1 ) * sizeof( Pending ) );
+  if ( g->nodes == NULL || g->edges == NULL || b.table == NULL || path == NULL ) {
+    free( b.table );
+    free( path );
+    freeDawg( g );
+    return false;
+  }
+  memset( b.table, 0xFF, b.tableSize * sizeof( unsigned ) );
+
+  // The path of the last word, and its length.
+  char const *last = "";
+  int depth = 0;
+  path[ 0 ] = ( Pending ) { { 0 }, 0, 0 };
+
+  for ( unsigned i = 0; i < count && !b.failed; i++ ) {
+    char const *word = pool + offsets[ sorted[ i ] ];
+    int len = strlen( word );
+    if ( len > MAX_LENGTH ) {
+      b.failed = true;
+      break;
+    }
+
+    int common = 0;
+    while ( common < depth && word[ common ] == last[ common ] )
+      common++;
+
+    // Finish the part of the last word's path this one leaves, and
+    // point its edges at the finished nodes.
+    for ( ; depth > common; depth-- ) {
+      Pending *parent = &path[ depth - 1 ];
+      unsigned node = finishNode( &b, &path[ depth ] );
+      parent->edges[ parent->edgeCount - 1 ] |= node << EDGE_LETTER_BITS;
+    }
+
+    // Add the rest of this word, or count it again if it's repeated.
+    for ( ; depth < len; depth++ ) {
+      Pending *p = &path[ depth ];
+      p->edges[ p->edgeCount++ ] = word[ depth ] - 'a';
+      path[ depth + 1 ] = ( Pending ) { { 0 }, 0, 0 };
+    }
+    path[ len ].repeats++;
+    last = word;
+  }
+
+  // Finish what's left, up to the root.
+  for ( ; depth > 0; depth-- ) {
+    Pending *parent = &path[ depth - 1 ];
+    unsigned node = finishNode( &b, &path[ depth ] );
+    parent->edges[ parent->edgeCount - 1 ] |= node << EDGE_LETTER_BITS;
+  }
+  g->root = finishNode( &b, &path[ 0 ] );
+
+  free( b.table );
+  free( path );
+  if ( b.failed ) {
+    freeDawg( g );
+    return false;
+  }
+  return true;
+}
+
+void freeDawg( Dawg *g )
+{
+  free( g->nodes );
+  free( g->edges );
+  g->nodes = NULL;
+  g->edges = NULL;
+}
+
+void spellWord( Dawg const *g, unsigned rank, char *word )
+{
+  // Go past the words at each node, then past the subtrees before
+  // the one the word is in.
+  DawgNode const *n = &g->nodes[ g->root ];
+  int len = 0;
+  while ( rank >= n->repeats ) {
+    rank -= n->repeats;
+    for ( unsigned i = 0; i < n->edgeCount; i++ ) {
+      DawgEdge e = g->edges[ n->edges + i ];
+      DawgNode const *child = &g->nodes[ e >> EDGE_LETTER_BITS ];
+      if ( rank < child->words ) {
+        word[ len++ ] = 'a' + ( e & ( ( 1 << EDGE_LETTER_BITS ) - 1 ) );
+        n = child;
+        break;
+      }
+      rank -= child->words;
+    }
+  }
+  word[ len ] = '\0';
+}
+
+unsigned findLetters( Dawg const *g, char const *letters, bool exact, unsigned *found )
+{
+  Walk w = { g, { 0 }, 0, exact, found, 0 };
+  int left = 0;
+  for ( ; letters[ left ]; left++ ) {
+    if ( letters[ left ] == BLANK )
+      w.blanks++;
+    else
+      w.counts[ letters[ left ] - 'a' ]++;
+  }
+
+  walkLetters( &w, g->root, 0, left );
+  return w.count;
+}
+
+unsigned findPattern( Dawg const *g, char const *pattern, unsigned *found )
+{
+  Walk w = { g, { 0 }, 0, true, found, 0 };
+  int left = strlen( pattern );
+  bool open = left > 0 && pattern[ left - 1 ] == ANY_ENDING;
+  walkPattern( &w, g->root, 0, pattern, open ? left - 1 : left, open );
+  return w.count;
+}
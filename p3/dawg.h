@@ -0,0 +1,126 @@
+/**
+    @file dawg.h
+    @author Nicholas Board (ndboard)
+
+    Contains the directed acyclic word graph jumble keeps its words
+    in.  It's a trie with every set of identical subtrees merged into
+    one, so words that end the same way share the nodes for their
+    ending, and each word is stored in a few bytes.  Words are
+    numbered by their place in sorted order, and every node counts
+    the words below it, so a word can be spelled from its number and
+    the words with a prefix are a range of numbers.
+*/
+
+#ifndef _DAWG_H_
+#define _DAWG_H_
+
+#include <stdbool.h>
+
+/** Stands for any letter in a query. */
+#define BLANK '?'
+
+/** Ends a pattern, standing for any way of finishing the word. */
+#define ANY_ENDING '*'
+
+/** Bits of an edge that hold its letter, the rest its target. */
+#define EDGE_LETTER_BITS 5
+
+/** Most nodes a graph can have. */
+#define MAX_NODES ( 1u << ( 32 - EDGE_LETTER_BITS ) )
+
+/** A node of the graph, for every prefix with the same endings. */
+typedef struct {
+  /** The first of the node's edges, in order of their letters. */
+  unsigned edges;
+
+  /** Number of words from here to the end of the graph, and how many
+      times the path here is itself a word.  A word can be in a
+      dictionary more than once. */
+  unsigned words;
+  unsigned repeats;
+
+  /** Number of edges, and the fewest and most letters it takes to
+      finish a word from here. */
+  unsigned char edgeCount;
+  unsigned char shortest;
+  unsigned char longest;
+} DawgNode;
+
+/**
+    An edge of the graph, its letter less 'a' in the low
+    EDGE_LETTER_BITS, and the node it goes to in the rest.
+*/
+typedef unsigned DawgEdge;
+
+/** A word graph, its arrays allocated or mapped from a file. */
+typedef struct {
+  /** The nodes, and how many there are. */
+  DawgNode *nodes;
+  unsigned nodeCount;
+
+  /** The edges of every node, and how many there are. */
+  DawgEdge *edges;
+  unsigned edgeCount;
+
+  /** The node for the empty prefix. */
+  unsigned root;
+} Dawg;
+
+/**
+    Builds the graph of some words.
+
+    @param g The graph to fill in.
+    @param pool The words, each ended by a null.
+    @param offsets Where each word starts in the pool.
+    @param sorted The numbers of the words, in sorted order.
+    @param count The number of words.
+    @return True, or false if the graph can't be allocated or is
+            too large.
+*/
+bool buildDawg( Dawg *g, char const *pool, unsigned const *offsets,
+                unsigned const *sorted, unsigned count );
+
+/**
+    Frees a graph's allocated space.
+
+    @param g The graph to free.
+*/
+void freeDawg( Dawg *g );
+
+/**
+    Spells a word from its place in sorted order.
+
+    @param g The graph.
+    @param rank The place of the word.
+    @param word Filled with the word, with room for the longest word
+                in the graph and a null.
+*/
+void spellWord( Dawg const *g, unsigned rank, char *word );
+
+/**
+    Finds the words that can be built from some letters, using each
+    one at most once.
+
+    @param g The graph to search.
+    @param letters The letters, lowercase or BLANK.
+    @param exact True if every letter has to be used.
+    @param found Filled with the places of the words, in sorted order,
+                 with room for every word in the graph.
+    @return The number of words found.
+*/
+unsigned findLetters( Dawg const *g, char const *letters, bool exact, unsigned *found );
+
+/**
+    Finds the words that match a pattern, letter for letter.  A BLANK
+    matches any letter, and a pattern ending in ANY_ENDING matches
+    any word that starts with the rest of it.
+
+    @param g The graph to search.
+    @param pattern The pattern.
+    @param found Filled with the places of the words, in sorted order,
+                 with room for every word in the graph.
+    @return The number of words found.
+*/
+unsigned findPattern( Dawg const *g, char const *pattern, unsigned *found );
+
+#endif
@@ -0,0 +1,308 @@
+/**
+    @file dictionary.c
+    @author Nicholas Board (ndboard)
+
+    Builds, saves and maps in dictionaries.  An index file is the
+    dictionary's arrays one after another, in the machine's own byte
+    order, behind a header giving their sizes:
+
+      the header
+      the anagram table, slotCount slots
+      the words of each group, count numbers
+      the nodes of the word graph, nodeCount of them
+      its edges, edgeCount of them
+      the place of each word in sorted order, rankCount numbers
+      the word at each place, rankCount numbers
+
+    The last two are left out, with a rankCount of zero, when the word
+    file was already sorted.  Mapping it in only has to check the
+    header and point the arrays into the mapping.  An index file is
+    trusted like the program itself, so it has to be one written by
+    --build-index.  Damage that changes its size or header is caught,
+    and so is an anagram group that runs past the list of words, but
+    not much else.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "dictionary.h"
+
+/** Marks the start of an index file. */
+#define INDEX_MAGIC "JUMBLEIX"
+#define MAGIC_LENGTH 8
+
+/** Version of the layout, changed whenever it is. */
+#define INDEX_VERSION 2
+
+/** The start of an index file. */
+typedef struct {
+  /** INDEX_MAGIC, without its null. */
+  char magic[ MAGIC_LENGTH ];
+
+  /** INDEX_VERSION. */
+  unsigned version;
+
+  /** Number of words, and slots in the anagram table. */
+  unsigned count;
+  unsigned slotCount;
+
+  /** Number of nodes and edges in the word graph, and its root. */
+  unsigned nodeCount;
+  unsigned edgeCount;
+  unsigned root;
+
+  /** Number of words in the arrays between numbers and places. */
+  unsigned rankCount;
+
+  /** Keeps the anagram table after the header lined up for its keys. */
+  unsigned padding;
+} IndexHeader;
+
+// The words being sorted, for compareWords.
+static char const *sortPool;
+static unsigned const *sortOffsets;
+
+/**
+    Orders word numbers by their words, for qsort, and numbers with
+    the same word by the numbers.
+
+    @param a Pointer to one word number.
+    @param b Pointer to the other word number.
+    @return Negative, zero or positive like strcmp.
+*/
+static int compareWords( void const *a, void const *b )
+{
+  unsigned i = *( unsigned const * ) a;
+  unsigned j = *( unsigned const * ) b;
+  int cmp = strcmp( sortPool + sortOffsets[ i ], sortPool + sortOffsets[ j ] );
+  if ( cmp != 0 )
+    return cmp;
+  return ( i > j ) - ( i < j );
+}
+
+/**
+    Orders word numbers for qsort.
+
+    @param a Pointer to one word number.
+    @param b Pointer to the other word number.
+    @return Negative, zero or positive as a is before, the same as or
+            after b.
+*/
+static int compareIds( void const *a, void const *b )
+{
+  unsigned i = *( unsigned const * ) a;
+  unsigned j = *( unsigned const * ) b;
+  return ( i > j ) - ( i < j );
+}
+
+/**
+    Turns the places of words found in the graph into their numbers,
+    in order.
+
+    @param d The dictionary.
+    @param found The places, replaced by the numbers.
+    @param count The number of words found.
+*/
+static void placesToNumbers( Dictionary const *d, unsigned *found, unsigned count )
+{
+  if ( d->order == NULL )
+    return;
+
+  for ( unsigned i = 0; i < count; i++ )
+    found[ i ] = d->order[ found[ i ] ];
+  qsort( found, count, sizeof( unsigned ), compareIds );
+}
+
+bool buildDictionary( Dictionary *d, char const *pool, unsigned const *offsets,
+                      unsigned count )
+{
+  d->count = count;
+  d->ranks = NULL;
+  d->order = NULL;
+  d->map = NULL;
+  d->mapSize = 0;
+
+  size_t size = count > 0 ? count : 1;
+  unsigned *order = ( unsigned * ) malloc( size * sizeof( unsigned ) );
+  LetterKey *keys = ( LetterKey * ) malloc( size * sizeof( LetterKey ) );
+  if ( order == NULL || keys == NULL ) {
+    free( order );
+    free( keys );
+    return false;
+  }
+
+  // Find what letters are in every word, and whether the words are
+  // already in order.
+  bool sorted = true;
+  for ( unsigned i = 0; i < count; i++ ) {
+    order[ i ] = i;
+    keys[ i ] = letterKey( pool + offsets[ i ] );
+    if ( i > 0 && strcmp( pool + offsets[ i - 1 ], pool + offsets[ i ] ) > 0 )
+      sorted = false;
+  }
+  if ( !sorted ) {
+    sortPool = pool;
+    sortOffsets = offsets;
+    qsort( order, count, sizeof( unsigned ), compareWords );
+  }
+
+  // Group the words, then the keys aren't needed anymore.
+  bool built = buildAnagrams( &d->anagrams, keys, count );
+  free( keys );
+  if ( !built ) {
+    free( order );
+    return false;
+  }
+
+  if ( !buildDawg( &d->dawg, pool, offsets, order, count ) ) {
+    freeAnagrams( &d->anagrams );
+    free( order );
+    return false;
+  }
+
+  // Words only need to be mapped between numbers and places if
+  // they're different.
+  if ( sorted ) {
+    free( order );
+    return true;
+  }
+
+  unsigned *ranks = ( unsigned * ) malloc( size * sizeof( unsigned ) );
+  if ( ranks == NULL ) {
+    freeDawg( &d->dawg );
+    freeAnagrams( &d->anagrams );
+    free( order );
+    return false;
+  }
+  for ( unsigned i = 0; i < count; i++ )
+    ranks[ order[ i ] ] = i;
+  d->ranks = ranks;
+  d->order = order;
+  return true;
+}
+
+bool saveDictionary( Dictionary const *d, char const *filename )
+{
+  FILE *fp = fopen( filename, "wb" );
+  if ( fp == NULL )
+    return false;
+
+  unsigned rankCount = d->order == NULL ? 0 : d->count;
+  IndexHeader header = { INDEX_MAGIC, INDEX_VERSION, d->count, d->anagrams.slotCount,
+                         d->dawg.nodeCount, d->dawg.edgeCount, d->dawg.root, rankCount, 0 };
+  bool ok = fwrite( &header, sizeof( header ), 1, fp ) == 1 &&
+            fwrite( d->anagrams.slots, sizeof( AnagramSlot ), d->anagrams.slotCount,
+                    fp ) == d->anagrams.slotCount &&
+            fwrite( d->anagrams.words, sizeof( unsigned ), d->count, fp ) == d->count &&
+            fwrite( d->dawg.nodes, sizeof( DawgNode ), d->dawg.nodeCount,
+                    fp ) == d->dawg.nodeCount &&
+            fwrite( d->dawg.edges, sizeof( DawgEdge ), d->dawg.edgeCount,
+                    fp ) == d->dawg.edgeCount;
+  if ( ok && rankCount > 0 )
+    ok = fwrite( d->ranks, sizeof( unsigned ), rankCount, fp ) == rankCount &&
+         fwrite( d->order, sizeof( unsigned ), rankCount, fp ) == rankCount;
+
+  return fclose( fp ) == 0 && ok;
+}
+
+int loadDictionary( Dictionary *d, char const *filename )
+{
+  int fd = open( filename, O_RDONLY );
+  if ( fd < 0 )
+    return DICTIONARY_NOT_INDEX;
+
+  // Anything that doesn't start like an index file is left to be
+  // read as a list of words.
+  IndexHeader header;
+  struct stat info;
+  if ( read( fd, &header, sizeof( header ) ) != sizeof( header ) ||
+       memcmp( header.magic, INDEX_MAGIC, MAGIC_LENGTH ) != 0 || fstat( fd, &info ) != 0 ) {
+    close( fd );
+    return DICTIONARY_NOT_INDEX;
+  }
+
+  // The arrays have to fill the rest of the file exactly.
+  size_t slotBytes = ( size_t ) header.slotCount * sizeof( AnagramSlot );
+  size_t countBytes = ( size_t ) header.count * sizeof( unsigned );
+  size_t nodeBytes = ( size_t ) header.nodeCount * sizeof( DawgNode );
+  size_t edgeBytes = ( size_t ) header.edgeCount * sizeof( DawgEdge );
+  size_t rankBytes = ( size_t ) header.rankCount * sizeof( unsigned );
+  size_t size = sizeof( header ) + slotBytes + countBytes + nodeBytes + edgeBytes +
+                2 * rankBytes;
+  if ( header.version != INDEX_VERSION || header.slotCount < 2 ||
+       ( header.slotCount & ( header.slotCount - 1 ) ) != 0 ||
+       header.root >= header.nodeCount ||
+       ( header.rankCount != 0 && header.rankCount != header.count ) ||
+       ( off_t ) size != info.st_size ) {
+    close( fd );
+    return DICTIONARY_INVALID;
+  }
+
+  char *map = mmap( NULL, size, PROT_READ, MAP_PRIVATE, fd, 0 );
+  close( fd );
+  if ( map == MAP_FAILED )
+    return DICTIONARY_INVALID;
+
+  char *pos = map + sizeof( header );
+  d->anagrams.slots = ( AnagramSlot * ) pos;
+  d->anagrams.slotCount = header.slotCount;
+  pos += slotBytes;
+  d->anagrams.words = ( unsigned * ) pos;
+  d->anagrams.wordCount = header.count;
+  pos += countBytes;
+  d->dawg.nodes = ( DawgNode * ) pos;
+  d->dawg.nodeCount = header.nodeCount;
+  pos += nodeBytes;
+  d->dawg.edges = ( DawgEdge * ) pos;
+  d->dawg.edgeCount = header.edgeCount;
+  d->dawg.root = header.root;
+  pos += edgeBytes;
+  d->ranks = header.rankCount > 0 ? ( unsigned const * ) pos : NULL;
+  pos += rankBytes;
+  d->order = header.rankCount > 0 ? ( unsigned const * ) pos : NULL;
+  d->count = header.count;
+  d->map = map;
+  d->mapSize = size;
+  return DICTIONARY_OK;
+}
+
+void freeDictionary( Dictionary *d )
+{
+  if ( d->map != NULL ) {
+    munmap( d->map, d->mapSize );
+    d->map = NULL;
+    return;
+  }
+
+  freeAnagrams( &d->anagrams );
+  freeDawg( &d->dawg );
+  free( ( void * ) d->ranks );
+  free( ( void * ) d->order );
+  d->ranks = NULL;
+  d->order = NULL;
+}
+
+void dictionaryWord( Dictionary const *d, unsigned i, char *word )
+{
+  spellWord( &d->dawg, d->ranks == NULL ? i : d->ranks[ i ], word );
+}
+
+unsigned dictionaryLetters( Dictionary const *d, char const *letters, bool exact,
+                            unsigned *found )
+{
+  unsigned count = findLetters( &d->dawg, letters, exact, found );
+  placesToNumbers( d, found, count );
+  return count;
+}
+
+unsigned dictionaryPattern( Dictionary const *d, char const *pattern, unsigned *found )
+{
+  unsigned count = findPattern( &d->dawg, pattern, found );
+  placesToNumbers( d, found, count );
+  return count;
+}
@@ -0,0 +1,125 @@
+/**
+    @file dictionary.h
+    @author Nicholas Board (ndboard)
+
+    Contains the dictionary jumble searches: a word graph holding the
+    words, and the index of them by their letters.  Words keep the
+    numbers of their places in the word file, which is the order
+    they're reported in.  It's built from a word file, and can be
+    saved as an index file and mapped back in later, ready to search
+    without reading any words.
+*/
+
+#ifndef _DICTIONARY_H_
+#define _DICTIONARY_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "anagram.h"
+#include "dawg.h"
+
+// Results from loading an index file.
+#define DICTIONARY_OK 0
+#define DICTIONARY_NOT_INDEX 1
+#define DICTIONARY_INVALID 2
+
+/** The words of a dictionary and their index. */
+typedef struct {
+  /** Number of words. */
+  unsigned count;
+
+  /** The words. */
+  Dawg dawg;
+
+  /** The place of each word in sorted order, and the word at each
+      place.  Both are NULL if the word file was already sorted, so
+      the places and the numbers are the same. */
+  unsigned const *ranks;
+  unsigned const *order;
+
+  /** The words grouped by their letters. */
+  AnagramIndex anagrams;
+
+  /** The mapped index file, if it was loaded from one. */
+  void *map;
+  size_t mapSize;
+} Dictionary;
+
+/**
+    Builds a dictionary of some words.  The words are only needed
+    while it's built.
+
+    @param d The dictionary to fill in.
+    @param pool The words, each ended by a null.
+    @param offsets Where each word starts in the pool, in the order of
+                   the word file.
+    @param count The number of words.
+    @return True, or false if the dictionary can't be allocated.
+*/
+bool buildDictionary( Dictionary *d, char const *pool, unsigned const *offsets,
+                      unsigned count );
+
+/**
+    Writes a dictionary out as an index file.
+
+    @param d The dictionary to save.
+    @param filename The file to write.
+    @return True, or false if the file can't be written.
+*/
+bool saveDictionary( Dictionary const *d, char const *filename );
+
+/**
+    Maps in a dictionary from an index file.
+
+    @param d The dictionary to fill in.
+    @param filename The file to map.
+    @return DICTIONARY_OK, DICTIONARY_NOT_INDEX if the file isn't an
+            index file, like a plain list of words, or
+            DICTIONARY_INVALID if it is one but it's damaged.
+*/
+int loadDictionary( Dictionary *d, char const *filename );
+
+/**
+    Frees a dictionary's allocated space, or unmaps it.
+
+    @param d The dictionary to free.
+*/
+void freeDictionary( Dictionary *d );
+
+/**
+    Spells a word of a dictionary.
+
+    @param d The dictionary.
+    @param i The number of the word.
+    @param word Filled with the word, with room for the longest word
+                and a null.
+*/
+void dictionaryWord( Dictionary const *d, unsigned i, char *word );
+
+/**
+    Finds the words that can be built from some letters, using each
+    one at most once.
+
+    @param d The dictionary to search.
+    @param letters The letters, lowercase or BLANK.
+    @param exact True if every letter has to be used.
+    @param found Filled with the numbers of the words, in order, with
+                 room for every word in the dictionary.
+    @return The number of words found.
+*/
+unsigned dictionaryLetters( Dictionary const *d, char const *letters, bool exact,
+                            unsigned *found );
+
+/**
+    Finds the words that match a pattern, letter for letter, with
+    BLANK for any letter and a final ANY_ENDING for any ending.
+
+    @param d The dictionary to search.
+    @param pattern The pattern.
+    @param found Filled with the numbers of the words, in order, with
+                 room for every word in the dictionary.
+    @return The number of words found.
+*/
+unsigned dictionaryPattern( Dictionary const *d, char const *pattern, unsigned *found );
+
+#endif
@@ -8,29 +8,61 @@
     letters match any of the words in the dictionary.
     Continues to accept user input until the EOF character
     is reached.
+
+    The words are indexed by their letters when they're read, so the
+    matches for a set of letters are found with one lookup instead of
+    comparing them against every word.  jumble --build-index saves
+    the index in a file, which later runs can map in and use right
+    away, without reading any words.
+
+    With -s, every word that can be built from some of the letters
+    is reported, not just the ones that use them all.  A ? in the
+    letters stands for any letter.  With -p, the letters are a pattern
+    instead, matched in order, where a ? is any letter and a * at the
+    end is any ending.  These are found by walking the word graph the
+    words are kept in, which shares the nodes for their common
+    beginnings and endings.
 */
 #include<stdio.h>
+#include<stdlib.h>
 #include<stdbool.h>
 #include<string.h>
+#include"dictionary.h"
 
-/** Definitions for controlling the lengths of strings. */
-#define MAX_WORDS 100000
+/** Definitions for controlling the lengths of strings, and the number of words. */
+#define MAX_WORDS 16000000
 #define MAX_WORD_LENGTH 20
 #define EXTRA_WORD_LENGTH 22
 
-/** Declare allowed global variables, the word array and wordCount. */
-char words[MAX_WORDS][EXTRA_WORD_LENGTH];
+/** Declare allowed global variables, the words as they're read and wordCount.
+    The words are only kept until the dictionary is built. */
+char *pool = NULL;
+unsigned *offsets = NULL;
 int wordCount = 0;
 
+/** The words and their index, built from the words or mapped from an index file. */
+Dictionary dictionary;
+
+/** True if words can use just some of the letters, with -s, or if the
+    letters are a pattern, with -p. */
+bool subAnagrams = false;
+bool patterns = false;
+
+/** Room for the words found by a search. */
+unsigned *found = NULL;
+
 /** Prototype functions called during the main. */
-void readWords( char const * );
+bool readWords( char const * );
+bool checkWords( void );
 bool getLetters( char * );
-bool matches( char const *, char const * );
 
 /**
-    Starts the program.  Makes sure that the proper file can be opened,
-    passes it to readWords to populate words.  Then constantly calls
-    getLetters until EOF is reached.
+    Starts the program.  Makes sure that the proper file can be opened.
+    An index file is mapped in, and anything else is passed to readWords
+    to populate words, which are then indexed.  Then constantly calls
+    getLetters until EOF is reached.  With --build-index, the index is
+    written to a file instead.  With -s, letters match words that use
+    only some of them, and with -p, they're patterns.
 
     @param argc The number of command-line arguments.
     @param argv The list of command-line arguments.
@@ -41,94 +73,180 @@ int main(  int argc, char *argv[]  )
 {
   char letters[EXTRA_WORD_LENGTH];
   
-  // Check to make sure the number of command line arguments is one.
+  // Check to make sure the command line arguments are either one
+  // file, maybe after -s or -p, or --build-index and two files.
   // If not, print error message and return 1.
-  if ( argc != 2 ) {
-    fprintf( stderr, "usage: jumble <word-file>\n" );
+  bool build = argc == 4 && strcmp( argv[1], "--build-index" ) == 0;
+  subAnagrams = argc == 3 && strcmp( argv[1], "-s" ) == 0;
+  patterns = argc == 3 && strcmp( argv[1], "-p" ) == 0;
+  if ( argc != 2 && !build && !subAnagrams && !patterns ) {
+    fprintf( stderr, "usage: jumble [-s|-p] <word-file>\n"
+                     "       jumble --build-index <word-file> <index-file>\n"
+                     "An index file can stand in for its word file.  It's trusted, so only\n"
+                     "use ones written by --build-index.\n" );
     return 1;
   }
+  char const *wordFile = argv[build ? 2 : argc - 1];
   
   // Check to make sure file exists and can be read.
   // If not, print error message and return 1.
   // Close the file after these checks.
-  FILE *inputFile = fopen( argv[1], "r" );
+  FILE *inputFile = fopen( wordFile, "r" );
   if ( inputFile == NULL ) {
     fprintf( stderr, "Can't open word file\n" );
     return 1;
   }
   fclose( inputFile );
   
-  // Call readWords to populate the words array.
-  readWords( argv[1] );
+  // An index file is ready to use as soon as it's mapped.
+  int loaded = build ? DICTIONARY_NOT_INDEX : loadDictionary( &dictionary, wordFile );
+  if ( loaded == DICTIONARY_INVALID ) {
+    fprintf( stderr, "Invalid index file\n" );
+    return 1;
+  }
   
-  // Cycle through every word and check that it is no longer
-  // than 20 characters, and consists only of lowercases.
-  int countCheck = 0;
-  int currentLen = 0;
-  for ( int i = 0; i < wordCount; i++ ) {
+  if ( loaded == DICTIONARY_NOT_INDEX ) {
 
-    currentLen = strlen( words[i] );
-    if ( currentLen > MAX_WORD_LENGTH ) {
+    // Call readWords to populate the words, and make sure
+    // they're all valid.
+    if ( !readWords( wordFile ) ) {
+      fprintf( stderr, "Can't index word file\n" );
+      return 1;
+    }
+    if ( !checkWords() ) {
       fprintf( stderr, "Invalid word file\n" );
       return 1;
     }
     
-    for ( int j = 0; words[i][j]; j++ ) {
-
-      if ( words[i][j] < 'a' || words[i][j] > 'z' ) {
-        fprintf( stderr, "Invalid word file\n" );
-        return 1;
-      }
+    // Build the word graph and group the words by their letters,
+    // then the words themselves aren't needed anymore.
+    bool built = buildDictionary( &dictionary, pool, offsets, wordCount );
+    free( pool );
+    free( offsets );
+    if ( !built ) {
+      fprintf( stderr, "Can't index word file\n" );
+      return 1;
     }
-    
-    countCheck++;
   }
   
-  // Make sure that we haven't exceeded the max amount of words.
-  if ( wordCount > MAX_WORDS ) {
-    fprintf( stderr, "Invalid word file\n" );
-    return 1;
+  // Save the index, if that's all that was asked for.
+  if ( build ) {
+    bool saved = saveDictionary( &dictionary, argv[3] );
+    freeDictionary( &dictionary );
+    if ( !saved ) {
+      fprintf( stderr, "Can't write index file\n" );
+      return 1;
+    }
+    return 0;
   }
   
-  //Make sure that wordCount is correct.
-  if ( wordCount != countCheck ) {
-    fprintf( stderr, "Invalid word file\n" );
+  // Make room for the words a search can find.
+  found = ( unsigned * ) malloc( ( dictionary.count > 0 ? dictionary.count : 1 ) *
+                                 sizeof( unsigned ) );
+  if ( found == NULL ) {
+    fprintf( stderr, "Can't index word file\n" );
     return 1;
   }
   
   //Call getLetters until EOF is reached.
   while ( getLetters( letters ) == 0);
   
-  // Exit successfully.
+  // Free the dictionary, and exit successfully.
+  free( found );
+  freeDictionary( &dictionary );
   return 0;
 }
 
 /**
-    Reads words from the input file and fills the global
-    words array.
+    Checks the words that were read.  There can't be too many,
+    and each has to be no longer than 20 characters and consist
+    only of lowercases.
+
+    @return True if the words are valid.
+*/
+bool checkWords( void )
+{
+  // Make sure that we haven't exceeded the max amount of words.
+  if ( wordCount > MAX_WORDS )
+    return false;
+  
+  // Cycle through every word and check it.
+  int countCheck = 0;
+  int currentLen = 0;
+  for ( int i = 0; i < wordCount; i++ ) {
+
+    char const *word = pool + offsets[i];
+    currentLen = strlen( word );
+    if ( currentLen > MAX_WORD_LENGTH )
+      return false;
+    
+    for ( int j = 0; word[j]; j++ ) {
+
+      if ( word[j] < 'a' || word[j] > 'z' )
+        return false;
+    }
+    
+    countCheck++;
+  }
+  
+  //Make sure that wordCount is correct.
+  return wordCount == countCheck;
+}
+
+/**
+    Reads words from the input file into the global pool of
+    words, growing it as needed, and notes where each one starts.
+    If there are too many, wordCount is left one past the maximum.
 
     @param filename The file to be processed.
+    
+    @return True, or false if there isn't enough memory.
 */
-void readWords( char const *filename )
+bool readWords( char const *filename )
 {
   // Opens the filestream for the inputfile.
   FILE *inputFile = fopen( filename, "r" );
   
-  // Populate the words array, increment wordCount.
-  while ( fscanf( inputFile, "%21s", words[wordCount] ) == 1 ) {
+  // Populate the pool, increment wordCount.
+  char word[EXTRA_WORD_LENGTH];
+  size_t poolSize = 0;
+  size_t poolCap = 0;
+  int wordCap = 0;
+  while ( wordCount <= MAX_WORDS && fscanf( inputFile, "%21s", word ) == 1 ) {
+
+    size_t len = strlen( word ) + 1;
+    if ( poolSize + len > poolCap ) {
+      poolCap = poolCap > 0 ? 2 * poolCap : 4096;
+      char *grown = ( char * ) realloc( pool, poolCap );
+      if ( grown == NULL )
+        break;
+      pool = grown;
+    }
+    if ( wordCount == wordCap ) {
+      wordCap = wordCap > 0 ? 2 * wordCap : 1024;
+      unsigned *grown = ( unsigned * ) realloc( offsets, wordCap * sizeof( unsigned ) );
+      if ( grown == NULL )
+        break;
+      offsets = grown;
+    }
 
+    memcpy( pool + poolSize, word, len );
+    offsets[wordCount] = poolSize;
+    poolSize += len;
     wordCount++;
   }
   
-  // Close the file stream.
+  // Close the file stream, and make sure every word was read.
+  bool ended = feof( inputFile ) || wordCount > MAX_WORDS;
   fclose( inputFile );
+  return ended;
 }
 
 /**
     Prompts the user for input and will fill the letters array.
     Makes sure the number of letters does not exceed 20, and are
-    all lowercase.  Then calls the matches function and loops
-    until EOF is reached.
+    all lowercase or blanks, or a pattern with -p.  Then reports
+    the words that match and loops until EOF is reached.
 
     @param letters The array of lettesr to populate.
     
@@ -169,12 +287,22 @@ bool getLetters( char *letters )
 
     // Make sure that every character in letters is
     // either EOF, at which point we break out of the
-    // function, or a lowercase letter.
+    // function, a lowercase letter or a blank, or a
+    // final * in a pattern.
+    bool blanks = false;
     for ( int i = 0; letters[i]; i++ ) {
 
       if ( letters[i] == EOF )
         return 1;
 
+      if ( letters[i] == BLANK ) {
+        blanks = true;
+        continue;
+      }
+
+      if ( patterns && letters[i] == ANY_ENDING && letters[i + 1] == '\0' )
+        continue;
+
       if ( isValid && ( letters[i] < 'a' || letters[i] > 'z' ) ) {
 
         printf( "Invalid letters\n" );
@@ -182,16 +310,26 @@ bool getLetters( char *letters )
       }
     }
 
-    // If we have a valid string of letters, we compare
-    // it to every word in words, reporting matches.
+    // If we have a valid string of letters, we look up
+    // the words with the same letters, or search the word
+    // graph for patterns, some of the letters or blanks,
+    // reporting matches.
     if ( isValid ) {
 
-      for ( int i = 0; i < wordCount; i++ ) {
+      unsigned count;
+      unsigned const *matches = found;
+      if ( patterns )
+        count = dictionaryPattern( &dictionary, letters, found );
+      else if ( subAnagrams || blanks )
+        count = dictionaryLetters( &dictionary, letters, !subAnagrams, found );
+      else
+        matches = findAnagrams( &dictionary.anagrams, letterKey( letters ), &count );
 
-        if ( matches( words[i], letters ) ) {
+      char word[EXTRA_WORD_LENGTH];
+      for ( unsigned i = 0; i < count; i++ ) {
 
-          printf( "%s\n", words[i] );
-        }
+        dictionaryWord( &dictionary, matches[i], word );
+        printf( "%s\n", word );
       }
     }
   }
@@ -199,64 +337,3 @@ bool getLetters( char *letters )
   // Return successfully.
   return 0;
 }
-
-/**
-    Checks to see if the given set of letters matches, or is
-    an anagram of, the given word.
-
-    @param word The current word to compare against.
-    @param argv The letters to compare against.
-    
-    @return True or false if there is or isn't a match.
-*/
-bool matches( char const *word, char const *letters )
-{
-  // Check to make sure that the word and letters are the same length.
-  int len1 = strlen( word );
-  int len2 = strlen( letters );
-  
-  if ( len1 != len2 )
-    return 0;
-
-  // Declare two bool arrays that will be used for checking,
-  // and set every value to false.
-  bool matchW[len1];
-  bool matchL[len2];
-  
-  for ( int i = 0; i < len1; i++ ) {
-    matchW[i] = false;
-    matchL[i] = false;
-  }
-  
-  // For every letter in the word, compare it against every letter
-  // in letters, and check to make sure that letter hasn't been used yet.
-  // If two unused letters are matched, their corresponding values
-  // in the match arrays are set to true.
-  for ( int i = 0; word[i]; i++ ) {
-
-    for ( int j = 0; letters[j]; j++ ) {
-
-      if ( matchW[i] == false && matchL[j] == false && word[i] == letters[j] ) {
-
-        matchW[i] = true;
-        matchL[j] = true;
-        
-      }
-    }
-  }
-  
-  // Make sure every value in the word was matched.
-  for ( int i = 0; i < len1; i++ ) {
-    if ( matchW[i] == false )
-      return 0;
-  }
-  
-  // Make sure every value in the letters was matched.
-  for ( int i = 0; i < len1; i++ ) {
-    if ( matchL[i] == false )
-      return 0;
-  }
-  
-  // If all tests have passed, return true.
-  return 1;
-}
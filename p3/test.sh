@@ -118,7 +118,33 @@ testJumble 4 0 words-large.txt
 testJumble 5 0 words-small.txt
 testJumble 6 1 words-non-existent.txt
 testJumble 7 1 words-bad7.txt
-testJumble 8 1 words-bad8.txt
+testJumble 8 0 words-bad8.txt
+
+# Test the jumble program with an index file built ahead of time.
+./jumble --build-index words-large.txt words-large.idx
+testJumble 9 0 words-large.idx
+
+# Test sub-anagrams, and letters with blanks.
+testJumble 10 0 "-s words-med.txt"
+testJumble 11 0 words-med.txt
+
+# Test patterns, with blanks and a * for any ending.
+testJumble 12 0 "-p words-med.txt"
+
+# Test a word file that isn't sorted and has repeated words, read
+# directly and through an index file.
+testJumble 13 0 words-shuffled.txt
+testJumble 14 0 "-s words-shuffled.txt"
+testJumble 15 0 "-p words-shuffled.txt"
+./jumble --build-index words-shuffled.txt words-shuffled.idx
+testJumble 16 0 words-shuffled.idx
+testJumble 17 0 "-s words-shuffled.idx"
+testJumble 18 0 "-p words-shuffled.idx"
+
+# Test a word file with one word more than jumble allows.
+yes a | head -n 16000001 > words-huge.txt
+testJumble 19 1 words-huge.txt
+rm -f words-huge.txt
 
 # Test the puzzle program.
 testPuzzle 1 0